@@ -0,0 +1,120 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+//разбор манифестов при старте: последовательно против parallelFor, в зависимости от количества модулей
+//host-bench-manifests [amounts...], по умолчанию 64 256 1024; сборка с -DDCI_HOST_BENCH=ON
+
+#include <dci/host/module/manifest.hpp>
+#include "../src/parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace dci::host;
+
+namespace
+{
+    constexpr std::size_t servicesPerModule = 16;
+    constexpr std::size_t repeats = 5;
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<std::string> generate(const fs::path& dir, std::size_t amount)
+    {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+
+        std::vector<std::string> res;
+        res.reserve(amount);
+
+        for(std::size_t i{}; i<amount; ++i)
+        {
+            module::Manifest m;
+            m._valid = true;
+            m._name = "bench"+std::to_string(i);
+            m._mainBinary = m._name+".so";
+            for(std::size_t s{}; s<servicesPerModule; ++s)
+            {
+                m._serviceIds.emplace_back(dci::idl::IId{}, m._name+"::Service"+std::to_string(s));
+            }
+
+            res.emplace_back((dir / (m._name+".manifest")).string());
+            std::ofstream(res.back()) << m.toConf();
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class F>
+    double best(F&& f)
+    {
+        double res {};
+        for(std::size_t r{}; r<repeats; ++r)
+        {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            res = r ? std::min(res, us) : us;
+        }
+        return res;
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+int main(int argc, char* argv[])
+{
+    std::vector<std::size_t> amounts;
+    for(int i{1}; i<argc; ++i)
+    {
+        amounts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if(amounts.empty())
+    {
+        amounts = {64, 256, 1024};
+    }
+
+    const fs::path dir = fs::temp_directory_path() / ("dci-host-bench-manifests."+std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+
+    std::cout<<std::setw(8)<<"modules"<<std::setw(10)<<"threads"<<std::setw(14)<<"serial, us"<<std::setw(16)<<"parallel, us"<<std::setw(10)<<"speedup"<<std::endl;
+
+    for(std::size_t amount : amounts)
+    {
+        std::vector<std::string> paths = generate(dir, amount);
+        std::vector<module::Manifest> manifests(amount);
+
+        double serial = best([&]
+        {
+            for(std::size_t i{}; i<amount; ++i)
+            {
+                manifests[i].fromConfFile(paths[i]);
+            }
+        });
+
+        double parallel = best([&]
+        {
+            parallelFor(amount, [&](std::size_t i)
+            {
+                manifests[i].fromConfFile(paths[i]);
+            });
+        });
+
+        std::cout<<std::setw(8)<<amount<<std::setw(10)<<parallelism(amount)
+                 <<std::setw(14)<<std::fixed<<std::setprecision(0)<<serial
+                 <<std::setw(16)<<parallel
+                 <<std::setw(10)<<std::setprecision(2)<<serial/parallel<<std::endl;
+    }
+
+    fs::remove_all(dir);
+    return EXIT_SUCCESS;
+}
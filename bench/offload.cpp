@@ -0,0 +1,156 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+
+//пропускная способность --offload-threads: пачка вычислительных задач в потоке цикла против пула Offload
+//host-bench-offload [threads...], по умолчанию 1 2 4 8; сборка с -DDCI_HOST_BENCH=ON
+
+#include "../src/impl/offload.hpp"
+#include <dci/cmt.hpp>
+#include <dci/poll.hpp>
+#include <dci/sbs/owner.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace dci;
+using namespace dci::host::impl;
+
+namespace
+{
+    constexpr std::size_t jobs = 4096;
+    constexpr std::size_t jobIterations = 20000;
+    constexpr std::size_t repeats = 5;
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t work(std::uint64_t seed)
+    {
+        std::uint64_t x = seed | 1;
+        for(std::size_t i{}; i<jobIterations; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+        return x;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    //одна пачка задач, ожидание всех результатов в волокне цикла; 0 потоков - исполнение на месте
+    double batch(std::size_t threads, std::uint64_t& sink)
+    {
+        Offload offload;
+        offload.start(threads);
+
+        cmt::task::Owner owner;
+        auto start = std::chrono::steady_clock::now();
+
+        cmt::spawn() += owner * [&]
+        {
+            std::vector<cmt::Future<std::uint64_t>> results;
+            results.reserve(jobs);
+
+            for(std::size_t j{}; j<jobs; ++j)
+            {
+                if(threads)
+                {
+                    results.emplace_back(offload.run([j]{return work(j);}));
+                }
+                else
+                {
+                    sink += work(j);
+                }
+            }
+
+            for(cmt::Future<std::uint64_t>& r : results)
+            {
+                sink += r.value();
+            }
+
+            poll::stop();
+        };
+
+        if(std::error_code ec = poll::run())
+        {
+            std::cerr<<"poll run: "<<ec.message()<<std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        offload.stop();
+        return ms;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    double best(std::size_t threads, std::uint64_t& sink)
+    {
+        double res {};
+        for(std::size_t r{}; r<repeats; ++r)
+        {
+            double ms = batch(threads, sink);
+            res = r ? std::min(res, ms) : ms;
+        }
+        return res;
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+int main(int argc, char* argv[])
+{
+    std::vector<std::size_t> amounts;
+    for(int i{1}; i<argc; ++i)
+    {
+        amounts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if(amounts.empty())
+    {
+        amounts = {1, 2, 4, 8};
+    }
+
+    if(std::error_code ec = poll::initialize())
+    {
+        std::cerr<<"poll initialize: "<<ec.message()<<std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::uint64_t sink {};
+    {
+        sbs::Owner workPossibleOwner;
+        poll::workPossible() += workPossibleOwner * []
+        {
+            cmt::executeReadyFibers();
+        };
+
+        double inlineMs = best(0, sink);
+
+        std::cout<<std::setw(8)<<"threads"<<std::setw(12)<<"batch, ms"<<std::setw(14)<<"jobs/s"<<std::setw(10)<<"speedup"<<std::endl;
+        std::cout<<std::setw(8)<<"loop"<<std::fixed<<std::setprecision(1)<<std::setw(12)<<inlineMs
+                 <<std::setw(14)<<std::setprecision(0)<<jobs*1000/inlineMs<<std::setw(10)<<std::setprecision(2)<<1.0<<std::endl;
+
+        for(std::size_t threads : amounts)
+        {
+            if(!threads)
+            {
+                continue;
+            }
+
+            double ms = best(threads, sink);
+            std::cout<<std::setw(8)<<threads<<std::setprecision(1)<<std::setw(12)<<ms
+                     <<std::setw(14)<<std::setprecision(0)<<jobs*1000/ms<<std::setw(10)<<std::setprecision(2)<<inlineMs/ms<<std::endl;
+        }
+    }
+
+    poll::deinitialize();
+
+    //чтобы вычисления не были выброшены оптимизатором
+    return sink == 42 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+//поиск поставщика сервиса: прежние std::multimap против ServiceRegistry, по ILid и по тексту запроса;
+//текст - весь путь Manager::createService(alias) до модуля: прежде копия строки, разбор iid и multimap, теперь ServiceRegistry::resolve
+//host-bench-serviceRegistry [amounts...], по умолчанию 1000 4000 16000; сборка с -DDCI_HOST_BENCH=ON
+
+#include "../src/impl/serviceRegistry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace dci;
+using namespace dci::host::impl;
+
+namespace
+{
+    constexpr std::size_t lookups = 1u << 20;
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class F>
+    double nsPerLookup(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t found = f();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if(found != lookups)
+        {
+            std::cerr<<"lost lookups: "<<lookups-found<<std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        return ns / lookups;
+    }
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+int main(int argc, char* argv[])
+{
+    std::vector<std::size_t> amounts;
+    for(int i{1}; i<argc; ++i)
+    {
+        amounts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if(amounts.empty())
+    {
+        amounts = {1000, 4000, 16000};
+    }
+
+    std::cout<<std::setw(9)<<"services"
+             <<std::setw(16)<<"ilid multimap"<<std::setw(16)<<"ilid registry"
+             <<std::setw(17)<<"text multimap"<<std::setw(17)<<"text resolve"<<", ns/lookup"<<std::endl;
+
+    std::mt19937_64 rnd{42};
+
+    for(std::size_t amount : amounts)
+    {
+        std::vector<idl::ILid> ilids(amount);
+        std::vector<std::string> aliases(amount);
+
+        std::multimap<idl::ILid, Module*> oldProviders;
+        std::multimap<std::string, idl::ILid> oldAliases;
+        ServiceRegistry registry;
+
+        for(std::size_t i{}; i<amount; ++i)
+        {
+            ilids[i]._lid = static_cast<decltype(ilids[i]._lid)>(i*7+1);
+            ilids[i]._side = idl::ISide::primary;
+            aliases[i] = "bench::module"+std::to_string(i/16)+"::Service"+std::to_string(i);
+
+            Module* module = reinterpret_cast<Module*>(static_cast<std::uintptr_t>((i/16+1)*64));
+
+            oldProviders.emplace(ilids[i], module);
+            oldAliases.emplace(aliases[i], ilids[i]);
+
+            registry.addProvider(ilids[i], module);
+            registry.addAlias(aliases[i], ilids[i]);
+        }
+        registry.freeze();
+
+        std::vector<std::size_t> order(lookups);
+        for(std::size_t& o : order)
+        {
+            o = rnd() % amount;
+        }
+
+        double ilidOld = nsPerLookup([&]
+        {
+            std::size_t found{};
+            for(std::size_t o : order)
+            {
+                found += oldProviders.end() != oldProviders.find(ilids[o]);
+            }
+            return found;
+        });
+
+        double ilidNew = nsPerLookup([&]
+        {
+            std::size_t found{};
+            for(std::size_t o : order)
+            {
+                found += !!registry.provider(ilids[o]);
+            }
+            return found;
+        });
+
+        double aliasOld = nsPerLookup([&]
+        {
+            std::size_t found{};
+            for(std::size_t o : order)
+            {
+                std::string_view alias = aliases[o];
+
+                idl::ILid ilid;
+                if(ilid.fromIidText(std::string{alias}))
+                {
+                    continue;
+                }
+
+                auto iter = oldAliases.find(std::string{alias});
+                found += oldAliases.end() != iter && oldProviders.end() != oldProviders.find(iter->second);
+            }
+            return found;
+        });
+
+        double aliasNew = nsPerLookup([&]
+        {
+            std::size_t found{};
+            for(std::size_t o : order)
+            {
+                std::string_view alias = aliases[o];
+
+                idl::ILid ilid;
+                found += registry.resolve(alias, ilid) && registry.provider(ilid);
+            }
+            return found;
+        });
+
+        std::cout<<std::setw(9)<<amount<<std::fixed<<std::setprecision(1)
+                 <<std::setw(16)<<ilidOld<<std::setw(16)<<ilidNew
+                 <<std::setw(17)<<aliasOld<<std::setw(17)<<aliasNew<<std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
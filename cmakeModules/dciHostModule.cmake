@@ -1,8 +1,22 @@
+# встраивание манифеста в секцию .dci.manifest бинарника модуля: хост сверяет ее с *.manifest при обнаружении модулей,
+# а --genmanifest по уже встроенной секции не делает dlopen
+function(dciHostModuleEmbedCommand out target manifest)
+    set(res "")
+    if(UNIX AND NOT APPLE AND CMAKE_OBJCOPY AND NOT DCI_HOST_MODULE_NO_EMBED)
+        set(res
+            COMMAND ${CMAKE_OBJCOPY}
+                --remove-section=.dci.manifest
+                --add-section .dci.manifest=${manifest}
+                --set-section-flags .dci.manifest=noload,readonly
+                $<TARGET_FILE:${target}>)
+    endif()
+    set(${out} ${res} PARENT_SCOPE)
+endfunction()
 
 function(dciHostModule uname)
 
     include(CMakeParseArguments)
-    cmake_parse_arguments(OPTS "" "" "IMPLTARGETS" ${ARGN})
+    cmake_parse_arguments(OPTS "AGGREGATE" "" "IMPLTARGETS" ${ARGN})
 
     if(OPTS_IMPLTARGETS)
         message(FATAL_ERROR "not implemented yet")
@@ -30,13 +44,32 @@ function(dciHostModule uname)
     get_target_property(outDir ${target} LIBRARY_OUTPUT_DIRECTORY)
     set(manifest ${outDir}/${mname}.manifest)
 
-    file(RELATIVE_PATH path4Comment ${CMAKE_BINARY_DIR} ${manifest})
-    add_custom_command(OUTPUT ${manifest}
-        COMMAND host-cmd --genmanifest $<TARGET_FILE:${target}> --outfile ${manifest}
-        DEPENDS ${target} ${OPTS_IMPLTARGETS} host host-cmd
-        COMMENT "Generating ${path4Comment}")
+    if(OPTS_AGGREGATE OR DCI_HOST_MODULE_AGGREGATE)
+        # манифесты всех таких модулей генерируются одним запуском host-cmd, см. dciHostModulesAggregate
+        set_property(GLOBAL APPEND PROPERTY DCI_HOST_AGGREGATE_TARGETS ${target})
+        set_property(GLOBAL APPEND PROPERTY DCI_HOST_AGGREGATE_MANIFESTS ${manifest})
+
+        get_property(deferred GLOBAL PROPERTY DCI_HOST_AGGREGATE_DEFERRED)
+        if(NOT deferred)
+            set_property(GLOBAL PROPERTY DCI_HOST_AGGREGATE_DEFERRED TRUE)
+            cmake_language(DEFER DIRECTORY ${CMAKE_SOURCE_DIR} CALL dciHostModulesAggregate)
+        endif()
 
-    add_custom_target(${target}-manifest ALL SOURCES ${manifest})
+        add_custom_target(${target}-manifest ALL)
+        add_dependencies(${target}-manifest host-manifests)
+    else()
+        # шаг сборки самого модуля: выполняется только после его перелинковки и правит только его бинарник
+        file(RELATIVE_PATH path4Comment ${CMAKE_BINARY_DIR} ${manifest})
+        dciHostModuleEmbedCommand(embed ${target} ${manifest})
+        add_dependencies(${target} host-cmd)
+        add_custom_command(TARGET ${target} POST_BUILD
+            COMMAND host-cmd --genmanifest $<TARGET_FILE:${target}> --outfile ${manifest}
+            ${embed}
+            BYPRODUCTS ${manifest}
+            COMMENT "Generating ${path4Comment}")
+
+        add_custom_target(${target}-manifest ALL DEPENDS ${target})
+    endif()
 
     #target_sources(${target} PRIVATE ${manifest})
 
@@ -52,3 +85,43 @@ function(dciHostModule uname)
     dciIntegrationMeta(UNIT ${uname} TARGET ${uname} RESOURCE_FILE ${manifest} ${MANIFEST_PROJECTION})
     dciIntegrationMeta(DEPEND ${target}-manifest)
 endfunction()
+
+function(dciHostModulesAggregate)
+    get_property(targets GLOBAL PROPERTY DCI_HOST_AGGREGATE_TARGETS)
+    get_property(manifests GLOBAL PROPERTY DCI_HOST_AGGREGATE_MANIFESTS)
+
+    set(listFile ${CMAKE_BINARY_DIR}/dciHostManifests.list)
+    set(content "")
+    foreach(target manifest IN ZIP_LISTS targets manifests)
+        string(APPEND content "$<TARGET_FILE:${target}>\t${manifest}\n")
+    endforeach()
+    file(GENERATE OUTPUT ${listFile} CONTENT "${content}")
+
+    # манифесты с неизменным содержимым не перезаписываются, поэтому выход команды - отдельная метка;
+    # неперелинкованные бинарники уже несут секцию и читаются без dlopen
+    set(stamp ${CMAKE_BINARY_DIR}/dciHostManifests.stamp)
+    list(LENGTH manifests amount)
+    add_custom_command(OUTPUT ${stamp}
+        BYPRODUCTS ${manifests}
+        COMMAND host-cmd --genmanifest @${listFile}
+        COMMAND ${CMAKE_COMMAND} -E touch ${stamp}
+        DEPENDS ${targets} ${listFile} host host-cmd
+        COMMENT "Generating ${amount} module manifests")
+
+    # встраивание только в бинарники, чей манифест переписан или которые перелинкованы
+    set(embedStamps "")
+    foreach(target manifest IN ZIP_LISTS targets manifests)
+        dciHostModuleEmbedCommand(embed ${target} ${manifest})
+        if(embed)
+            set(embedStamp ${CMAKE_BINARY_DIR}/dciHostManifests/${target}.embedded)
+            add_custom_command(OUTPUT ${embedStamp}
+                ${embed}
+                COMMAND ${CMAKE_COMMAND} -E touch ${embedStamp}
+                DEPENDS ${manifest} ${target}
+                COMMENT "Embedding manifest into ${target}")
+            list(APPEND embedStamps ${embedStamp})
+        endif()
+    endforeach()
+
+    add_custom_target(host-manifests ALL DEPENDS ${stamp} ${embedStamps})
+endfunction()
@@ -9,8 +9,14 @@
 
 #include "host/manager.hpp"
 #include "host/exception.hpp"
+#include "host/fiberStats.hpp"
+#include "host/histogram.hpp"
+#include "host/loopStats.hpp"
+#include "host/handoff.hpp"
 #include "host/test.hpp"
 
+#include "host/module/arena.hpp"
 #include "host/module/entry.hpp"
 #include "host/module/stopLocker.hpp"
 #include "host/module/manifest.hpp"
+#include "host/module/servicePool.hpp"
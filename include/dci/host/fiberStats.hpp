@@ -0,0 +1,33 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include "histogram.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace dci::host
+{
+    //сводка планировщика волокон потока цикла, собирается Manager периодическим обходом cmt::enumerateFibers
+    struct FiberStats
+    {
+        //последний обход
+        std::size_t     _null {};
+        std::size_t     _ready {};
+        std::size_t     _work {};
+        std::size_t     _hold {};
+        std::size_t     _total {};
+        std::size_t     _peakTotal {};
+
+        std::uint64_t   _samples {};
+        Histogram       _readyDepth;    //готовых волокон перед executeReadyFibers, по обходам
+        Histogram       _holdDepth;     //ожидающих волокон, устойчивый рост - признак утечки
+
+        std::uint64_t   _batches {};    //вызовов executeReadyFibers
+    };
+}
@@ -0,0 +1,35 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include "api.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+//передача дескрипторов (слушающих сокетов и т.п.) и небольшого состояния демонов в процесс после перезапуска хоста
+//owner - имя демона, как в --run; в новом процессе одноименный демон забирает свое через take до собственного bind
+namespace dci::host::handoff
+{
+    //дескриптор дублируется, исходный остается у вызывающего; повторная регистрация того же имени заменяет прежнюю
+    API_DCI_HOST bool offer(const std::string& owner, const std::string& name, int fd, std::string_view state = {});
+    API_DCI_HOST void withdraw(const std::string& owner, const std::string& name);
+
+    //в новом процессе: -1 если ничего не передано, иначе дескриптор переходит во владение вызывающего
+    API_DCI_HOST int take(const std::string& owner, const std::string& name, std::string* state = nullptr);
+
+    //имена переданных владельцу и еще не забранных
+    API_DCI_HOST std::vector<std::string> pending(const std::string& owner);
+
+    //со стороны хоста
+    API_DCI_HOST void adopt();                  //при старте, опись из окружения
+    API_DCI_HOST bool prepareExec();            //перед execv, снимает FD_CLOEXEC и кладет опись в окружение
+    API_DCI_HOST void execFailed();             //execv не удался, FD_CLOEXEC обратно и опись из окружения
+    API_DCI_HOST std::size_t closeUnclaimed();  //после старта демонов
+    API_DCI_HOST std::size_t dropAdopted();     //молча, в процессах без демонов-получателей (воркеры кроме первого)
+}
@@ -0,0 +1,60 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include "api.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace dci::host
+{
+    //лог-линейная гистограмма: по 8 корзин на каждую степень двойки, относительная погрешность не более 1/8
+    class API_DCI_HOST Histogram
+    {
+    public:
+        static constexpr std::size_t _subBits = 3;
+        static constexpr std::size_t _subAmount = std::size_t{1} << _subBits;
+        static constexpr std::size_t _bucketsAmount = (64 - _subBits + 1) * _subAmount;
+
+    public:
+        struct Summary
+        {
+            std::uint64_t _count {};
+            std::uint64_t _p50 {};
+            std::uint64_t _p99 {};
+            std::uint64_t _p999 {};
+            std::uint64_t _max {};
+        };
+
+    public:
+        void add(std::uint64_t value, std::uint64_t times = 1);
+        void merge(const Histogram& other);
+        void reset();
+
+        std::uint64_t count() const;
+        std::uint64_t sum() const;
+        std::uint64_t min() const;
+        std::uint64_t max() const;
+
+        //верхняя граница корзины, в которую попадает доля p (0..1) значений
+        std::uint64_t percentile(double p) const;
+        Summary summary() const;
+
+        const std::array<std::uint64_t, _bucketsAmount>& buckets() const;
+        static std::size_t bucketIndex(std::uint64_t value);
+        static std::uint64_t bucketUpper(std::size_t index);
+
+    private:
+        std::array<std::uint64_t, _bucketsAmount>   _buckets {};
+        std::uint64_t                               _count {};
+        std::uint64_t                               _sum {};
+        std::uint64_t                               _min {~std::uint64_t{}};
+        std::uint64_t                               _max {};
+    };
+}
@@ -12,12 +12,20 @@
 #include <dci/host/implMetaInfo.hpp>
 #include <dci/host/module/manifest.hpp>
 #include <dci/host/exception.hpp>
+#include <dci/host/fiberStats.hpp>
+#include <dci/host/loopStats.hpp>
 #include <dci/idl/interface.hpp>
 #include <dci/idl/iId.hpp>
 #include <dci/idl/iLid.hpp>
 #include <dci/cmt.hpp>
 #include <dci/sbs/signal.hpp>
 #include "test.hpp"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
 
 namespace dci::host
 {
@@ -31,6 +39,10 @@ namespace dci::host
         static int executeTest(const std::vector<std::string>& argv, TestStage stage);
         static const module::Manifest& moduleManifest(const std::string& mainBinaryFullPath);
 
+        //для подготовки обновления в отдельном процессе: модули, чьи манифест или бинарник изменились с последнего старта
+        //хоста (по ../module/.index), реально загружаются, встроенный манифест сверяется с файлом целиком
+        static bool verifyModules();
+
     public:
         Manager();
         ~Manager();
@@ -38,12 +50,47 @@ namespace dci::host
         void run();//блокирующий
         void stop();//запрос на выход из run
 
+        void loadThreads(std::size_t amount);//потоки предварительного чтения бинарников модулей, 0 - без него
+        void offloadThreads(std::size_t amount);//вспомогательные потоки на все время run, 0 - нет
+        void drainTimeout(std::chrono::milliseconds timeout);//срок мягкой остановки модулей в stop, 0 - без ожидания
+        void restartDowntime(std::chrono::microseconds downtime);//простой перезапуска на обновление, замеренный новым процессом; в метрики
+
+        //сторожевой поток цикла: при зависании дольше stall - стек, модуль и его демоны в лог, дольше abort - аварийная остановка; 0 - выключено
+        void watchdog(std::chrono::milliseconds stall, std::chrono::milliseconds abort);
+
+        //применяется в начале run: привязка потока цикла и вспомогательных к процессорам ("0-3,8"), память к узлу numa
+        //пустой список и узел -1 - без ограничений
+        bool placement(const std::string& loopCpus, const std::string& helperCpus, int numaNode);
+
+        //период обхода волокон для fiberStats, 0 - без обхода; замеры executeReadyFibers ведутся всегда
+        void fiberStatsInterval(std::chrono::milliseconds interval);
+        const FiberStats& fiberStats();
+
+        //задержки цикла; без DCI_HOST_LOOP_STATS в сборке пусто, _enabled == false
+        const LoopStats& loopStats();
+
+        //из любого потока: f выполнится волокном в потоке цикла, принятые до остановки - при остановке;
+        //false если цикл не запущен или уже остановлен, тогда f не выполнится
+        bool post(std::function<void()>&& f);
+
+        //job во вспомогательном потоке, результат в потоке цикла; без вспомогательных потоков - на месте
+        cmt::Future<> runOffloaded(std::function<void()>&& job);
+
+        //манифесты и dlopen бинарников модулей до run, для разделения страниц с дочерними процессами после fork
+        bool preload();
         bool startModules(std::set<std::string>&& byNames, std::set<std::string>&& byServices);
 
         cmt::Future<int> runTest(const std::vector<std::string>& argv, TestStage stage);
         cmt::Future<> runDaemon(const std::vector<std::string>& argv);
         cmt::Future<> runDaemons(const std::vector<std::string>& argv);
 
+        //перезагрузка одного модуля с диска без остановки остальных, его демоны перезапускаются с прежними аргументами
+        //отменяется со старым бинарником, если после drain остались StopLocker или живые объекты сервисов модуля
+        cmt::Future<> reloadModule(const std::string& name);
+
+        //в потоке цикла: бинарники модулей выгружены или загружены заново (reloadModule)
+        sbs::Signal<> binariesChanged();
+
         cmt::Future<idl::Interface> createService(const idl::IId& iid);
         cmt::Future<idl::Interface> createService(idl::ILid ilid);
         cmt::Future<idl::Interface> createService(const std::string& alias);
@@ -51,10 +98,20 @@ namespace dci::host
         template <class Interface>
         cmt::Future<Interface> createService();
 
+        //пакетное создание, запросы группируются по модулям-поставщикам
+        //результаты в порядке запросов, у каждого свой исход
+        using ServiceRequest = std::variant<idl::IId, idl::ILid, std::string>;
+        cmt::Future<std::vector<cmt::Future<idl::Interface>>> createServices(const std::vector<ServiceRequest>& requests);
+
+        template <class... Interfaces>
+        cmt::Future<std::tuple<Interfaces...>> createServices();
+
         cmt::Future<idl::Interface> getDaemonService(const std::string& name);
 
         template <class Interface>
         cmt::Future<Interface> getDaemonService(const std::string& name);
+
+        void startupReport(const std::string& jsonFile);//в лог, и в json если имя файла не пусто
     };
 
 
@@ -86,6 +143,65 @@ namespace dci::host
         });
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class... Interfaces>
+    cmt::Future<std::tuple<Interfaces...>> Manager::createServices()
+    {
+        using Results = std::vector<cmt::Future<idl::Interface>>;
+        using Tuple = std::tuple<Interfaces...>;
+
+        return createServices({ServiceRequest{Interfaces::lid()}...}).template apply<Tuple>([](auto in, cmt::Promise<Tuple>& out)
+        {
+            if(in.resolvedException())
+            {
+                out.resolveException(in.detachException());
+                return;
+            }
+            if(in.resolvedCancel())
+            {
+                out.resolveCancel();
+                return;
+            }
+
+            Results results = in.detachValue();
+
+            auto element = [&]<class Interface>(std::size_t index) -> Interface
+            {
+                std::string descr = "element "+std::to_string(index)+" ("+Interface::lid().toIidText()+")";
+
+                cmt::Future<idl::Interface>& f = results[index];
+                if(f.resolvedException())
+                {
+                    std::rethrow_exception(dci::exception::buildInstance<exception::UnableToCreateService>(f.detachException(), descr));
+                }
+                if(f.resolvedCancel())
+                {
+                    throw exception::UnableToCreateService(descr+": canceled");
+                }
+
+                Interface mdi(f.detachValue());
+                if(!mdi)
+                {
+                    throw exception::UnableToCreateService(descr+": null value from module received");
+                }
+
+                return mdi;
+            };
+
+            try
+            {
+                out.resolveValue([&]<std::size_t... indices>(std::index_sequence<indices...>)
+                {
+                    return Tuple{element.template operator()<Interfaces>(indices)...};
+                }(std::index_sequence_for<Interfaces...>{}));
+            }
+            catch(...)
+            {
+                out.resolveException(std::current_exception());
+            }
+        });
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Interface>
     cmt::Future<Interface> Manager::getDaemonService(const std::string& name)
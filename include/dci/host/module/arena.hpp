@@ -0,0 +1,91 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include "../api.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace dci::host::module
+{
+    //память под объекты сервисов одного модуля: один зарезервированный регион, классы размеров со списками свободных,
+    //при отсутствии живых объектов регион отдается системе целиком
+    //регион резервируется при первом размещении, размер задается манифестом модуля (arenaReserve), 0 - только общая куча
+    class API_DCI_HOST Arena
+    {
+        Arena(const Arena&) = delete;
+        void operator=(const Arena&) = delete;
+
+    public:
+        static constexpr std::size_t defaultReserve = std::size_t{8} << 20;
+
+        //гарантированное выравнивание размещений, и в регионе и в общей куче
+        static constexpr std::size_t alignment = std::min<std::size_t>(16, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    public:
+        struct Stats
+        {
+            std::size_t     _reserved {};       //размер региона
+            std::size_t     _touched {};        //занято сдвигом указателя в регионе
+            std::size_t     _used {};           //байт в живых объектах
+            std::size_t     _peak {};
+            std::uint64_t   _allocations {};
+            std::uint64_t   _frees {};
+            std::uint64_t   _fallbacks {};      //крупные или не поместившиеся, ушли в общую кучу
+            std::uint64_t   _releases {};       //сколько раз регион отдан системе
+        };
+
+    public:
+        Arena(std::size_t reserve = defaultReserve);
+        ~Arena();
+
+        //действует до первого размещения или после release
+        bool reserveSize(std::size_t reserve);
+        std::size_t reserveSize() const;
+
+        void* allocate(std::size_t size);
+        void deallocate(void* p, std::size_t size);
+
+        bool empty() const;
+        bool release();
+
+        //объекты, лежащие в пулах (ServicePool) без владельцев, учитываются отдельно от используемых
+        void pooledInc();
+        void pooledDec();
+        std::size_t live() const;
+        std::size_t pooled() const;
+
+        const Stats& stats() const;
+
+    private:
+        static constexpr std::size_t _granularity = 16;
+        static_assert(!(_granularity % alignment));
+        static constexpr std::size_t _maxClassed = 4096;
+        static constexpr std::size_t _classesAmount = _maxClassed / _granularity;
+
+        static std::size_t classIndex(std::size_t size);
+        bool reserve();
+        bool inRegion(void* p) const;
+
+    private:
+        struct FreeNode
+        {
+            FreeNode* _next;
+        };
+
+        std::size_t                             _reserveSize;
+        char*                                   _region {};
+        std::size_t                             _bump {};
+        std::array<FreeNode*, _classesAmount>   _free {};
+        std::size_t                             _live {};
+        std::size_t                             _pooled {};
+        Stats                                   _stats;
+    };
+}
@@ -8,8 +8,10 @@
 #pragma once
 
 #include "../api.hpp"
+#include "arena.hpp"
 #include "manifest.hpp"
 #include "serviceBase.hpp"
+#include "servicePool.hpp"
 #include <dci/cmt/future.hpp>
 #include <dci/cmt/promise.hpp>
 #include <dci/idl/interface.hpp>
@@ -43,10 +45,23 @@ namespace dci::host::module
 
         Manager* manager() const;
         StopLocker stopLocker();
+        std::size_t stopLocks() const;//сколько StopLocker удерживают остановку
+
+        //память объектов сервисов модуля, отдается системе при выгрузке
+        Arena& arena();
 
     protected:
+        //объект размещается в арене модуля, поэтому функция нестатическая (прежде была статической);
+        //вне экземпляра Entry - tryCreateHeapService, с размещением в общей куче
+        template <class Srv>
+        idl::Interface tryCreateService(idl::ILid ilid, auto&&... args) requires std::is_base_of_v<ServiceBase<Srv>, Srv>;
+
         template <class Srv>
-        static idl::Interface tryCreateService(idl::ILid ilid, auto&&... args) requires std::is_base_of_v<ServiceBase<Srv>, Srv>;
+        static idl::Interface tryCreateHeapService(idl::ILid ilid, auto&&... args) requires std::is_base_of_v<ServiceBase<Srv>, Srv>;
+
+        //пул заводится членом наследника поверх арены модуля: ServicePool<Srv> _pool{arena()};
+        template <PoolableService Srv>
+        static idl::Interface tryCreatePooledService(idl::ILid ilid, ServicePool<Srv>& pool);
 
     private:
         friend class StopLocker;
@@ -57,11 +72,47 @@ namespace dci::host::module
         Manager *       _manager = nullptr;
         std::size_t     _stopLockCounter {};
         cmt::Promise<>  _stopLock;
+        Arena           _arena;
     };
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     template <class Srv>
     idl::Interface Entry::tryCreateService(idl::ILid ilid, auto&&... args) requires std::is_base_of_v<ServiceBase<Srv>, Srv>
+    {
+        static_assert(alignof(Srv) <= Arena::alignment, "over-aligned service, use tryCreateHeapService");
+
+        if(Srv::Opposite::lid() != ilid)
+        {
+            return idl::Interface();
+        }
+
+        void* place = _arena.allocate(sizeof(Srv));
+        Srv* srv;
+        try
+        {
+            srv = ::new(place) Srv{std::forward<decltype(args)>(args)...};
+        }
+        catch(...)
+        {
+            _arena.deallocate(place, sizeof(Srv));
+            throw;
+        }
+
+        srv->involvedChanged() += srv->sol() * [this, srv](bool v)
+        {
+            if(!v)
+            {
+                srv->~Srv();
+                _arena.deallocate(srv, sizeof(Srv));
+            }
+        };
+
+        return idl::Interface(srv->opposite());
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class Srv>
+    idl::Interface Entry::tryCreateHeapService(idl::ILid ilid, auto&&... args) requires std::is_base_of_v<ServiceBase<Srv>, Srv>
     {
         if(Srv::Opposite::lid() != ilid)
         {
@@ -79,4 +130,16 @@ namespace dci::host::module
 
         return idl::Interface(srv->opposite());
     }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    idl::Interface Entry::tryCreatePooledService(idl::ILid ilid, ServicePool<Srv>& pool)
+    {
+        if(Srv::Opposite::lid() != ilid)
+        {
+            return idl::Interface();
+        }
+
+        return idl::Interface(pool.acquire()->opposite());
+    }
 }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "../api.hpp"
+#include "arena.hpp"
 #include <dci/idl/iId.hpp>
 #include <dci/idl/iSide.hpp>
 #include <dci/idl/contract/mdDescriptor.hpp>
@@ -71,6 +72,23 @@ namespace dci::host::module
 
         std::vector<ServiceId>   _serviceIds;
 
+        //сервисы других модулей, нужные на старте: текст iid или алиас
+        template <template <idl::ISide> class C, idl::ISide s = idl::ISide::primary>
+        void pushRequire()
+        {
+            _requires.emplace_back(C<s>::Internal::id().toText());
+        }
+
+        void pushRequire(const std::string& iidOrAlias)
+        {
+            _requires.emplace_back(iidOrAlias);
+        }
+
+        std::vector<std::string> _requires;
+
+        //резерв адресного пространства под объекты сервисов модуля, байт; 0 - размещать в общей куче
+        std::size_t _arenaReserve = Arena::defaultReserve;
+
         void reset();
 
         bool fromConf(const std::string& conf);
@@ -0,0 +1,293 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include "arena.hpp"
+#include "serviceBase.hpp"
+#include <dci/poll.hpp>
+#include <dci/poll/awaker.hpp>
+#include <dci/sbs/owner.hpp>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace dci::host::module
+{
+    //сервис пригоден для пула если конструируется без аргументов и умеет сбрасываться в исходное состояние
+    //reset не должен трогать sol(), через него пул получает экземпляры обратно
+    template <class Srv>
+    concept PoolableService = std::is_base_of_v<ServiceBase<Srv>, Srv> && std::is_default_constructible_v<Srv> && requires(Srv& s)
+    {
+        s.reset();
+    };
+
+    //экземпляры размещаются в арене модуля (Entry::arena), как и у Entry::tryCreateService
+    template <PoolableService Srv>
+    class ServicePool
+    {
+        static_assert(alignof(Srv) <= Arena::alignment, "over-aligned service can't be pooled");
+
+        ServicePool(const ServicePool&) = delete;
+        void operator=(const ServicePool&) = delete;
+
+    public:
+        struct Stats
+        {
+            std::uint64_t _hits {};     //выдан готовый экземпляр
+            std::uint64_t _misses {};   //пул был пуст, экземпляр сконструирован на месте
+            std::uint64_t _returns {};  //освобожденный экземпляр сброшен и вернулся в пул
+            std::uint64_t _drops {};    //освобожденный экземпляр удален, пул полон или закрыт
+        };
+
+    public:
+        ServicePool(Arena& arena, std::size_t capacity = 16);
+        ~ServicePool();
+
+        void capacity(std::size_t capacity);
+        std::size_t capacity() const;
+        std::size_t size() const;
+
+        const Stats& stats() const;
+
+        //дозаполнение до capacity в простое цикла: по одному экземпляру на итерацию, после исполнения готовых волокон
+        void warmup();
+
+        Srv* acquire();
+        void clear();
+
+    private:
+        struct Core
+            : std::enable_shared_from_this<Core>
+        {
+            Arena *             _arena;
+            std::vector<Srv*>   _free;
+            std::size_t         _capacity {};
+            bool                _alive = true;
+            Stats               _stats;
+
+            Srv* make();
+            void destroy(Srv* srv);
+
+            void park(Srv* srv);
+            Srv* take();
+        };
+
+        void refill();
+
+    private:
+        std::shared_ptr<Core>           _core;
+        std::unique_ptr<poll::Awaker>   _awaker;
+        sbs::Owner                      _sol;
+        bool                            _warming = false;
+    };
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    Srv* ServicePool<Srv>::Core::make()
+    {
+        void* place = _arena->allocate(sizeof(Srv));
+        Srv* srv;
+        try
+        {
+            srv = ::new(place) Srv{};
+        }
+        catch(...)
+        {
+            _arena->deallocate(place, sizeof(Srv));
+            throw;
+        }
+
+        srv->involvedChanged() += srv->sol() * [srv, core=this->shared_from_this()](bool v)
+        {
+            if(v)
+            {
+                return;
+            }
+
+            if(core->_alive && core->_free.size() < core->_capacity)
+            {
+                srv->reset();
+                core->park(srv);
+                ++core->_stats._returns;
+                return;
+            }
+
+            ++core->_stats._drops;
+            core->destroy(srv);
+        };
+
+        return srv;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    void ServicePool<Srv>::Core::destroy(Srv* srv)
+    {
+        srv->~Srv();
+        _arena->deallocate(srv, sizeof(Srv));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    void ServicePool<Srv>::Core::park(Srv* srv)
+    {
+        _free.push_back(srv);
+        _arena->pooledInc();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    Srv* ServicePool<Srv>::Core::take()
+    {
+        Srv* srv = _free.back();
+        _free.pop_back();
+        _arena->pooledDec();
+        return srv;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    ServicePool<Srv>::ServicePool(Arena& arena, std::size_t capacity)
+        : _core{std::make_shared<Core>()}
+    {
+        _core->_arena = &arena;
+        _core->_capacity = capacity;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    ServicePool<Srv>::~ServicePool()
+    {
+        clear();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    void ServicePool<Srv>::capacity(std::size_t capacity)
+    {
+        _core->_capacity = capacity;
+
+        while(_core->_free.size() > capacity)
+        {
+            _core->destroy(_core->take());
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    std::size_t ServicePool<Srv>::capacity() const
+    {
+        return _core->_capacity;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    std::size_t ServicePool<Srv>::size() const
+    {
+        return _core->_free.size();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    const typename ServicePool<Srv>::Stats& ServicePool<Srv>::stats() const
+    {
+        return _core->_stats;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    void ServicePool<Srv>::warmup()
+    {
+        if(_warming || !_core->_alive || _core->_free.size() >= _core->_capacity)
+        {
+            return;
+        }
+
+        //подписка при первом дозаполнении: обработчик Manager, исполняющий готовые волокна, к этому моменту уже подключен
+        if(!_awaker)
+        {
+            _awaker = std::make_unique<poll::Awaker>(false);
+            poll::workPossible() += _sol * [this]
+            {
+                refill();
+            };
+        }
+
+        _warming = true;
+        _awaker->wakeup();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    void ServicePool<Srv>::refill()
+    {
+        if(!_warming)
+        {
+            return;
+        }
+
+        if(_core->_alive && _core->_free.size() < _core->_capacity)
+        {
+            _core->park(_core->make());
+        }
+
+        if(_core->_alive && _core->_free.size() < _core->_capacity)
+        {
+            //чтобы цикл не заснул в ожидании событий, пока пул не полон
+            _awaker->wakeup();
+            return;
+        }
+
+        _warming = false;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    Srv* ServicePool<Srv>::acquire()
+    {
+        Srv* srv;
+
+        if(_core->_free.empty())
+        {
+            ++_core->_stats._misses;
+            srv = _core->make();
+        }
+        else
+        {
+            ++_core->_stats._hits;
+            srv = _core->take();
+        }
+
+        warmup();
+        return srv;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <PoolableService Srv>
+    void ServicePool<Srv>::clear()
+    {
+        _sol.flush();
+        _awaker.reset();
+        _warming = false;
+
+        _core->_alive = false;
+        while(!_core->_free.empty())
+        {
+            _core->destroy(_core->take());
+        }
+
+        //экземпляры на руках вернутся уже в закрытый пул и будут удалены, новый Core для дальнейшей работы
+        auto core = std::make_shared<Core>();
+        core->_arena = _core->_arena;
+        core->_capacity = _core->_capacity;
+        core->_stats = _core->_stats;
+        _core = std::move(core);
+    }
+}
@@ -0,0 +1,556 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "crashDump.hpp"
+#include <dci/cmt.hpp>
+#include <dci/integration/info.hpp>
+#include <dci/utils/b2h.hpp>
+#include <boost/stacktrace.hpp>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#   include <windows.h>
+#   include <psapi.h>
+#   include <dbghelp.h>
+#   include <winnt.h>
+#   include <filesystem>
+#   include <fstream>
+#   include <vector>
+#else
+#   include <link.h>
+#   include <fcntl.h>
+#   include <signal.h>
+#   include <time.h>
+#   include <unistd.h>
+#   include <climits>
+#endif
+
+namespace dci::host::crashDump
+{
+    namespace
+    {
+        constexpr std::size_t pathCapacity      = 1024;
+        constexpr std::size_t infoCapacity      = 4096;
+        constexpr std::size_t objectsCapacity   = 256 * 1024;
+
+        char        dumpDirectory[pathCapacity];
+        char        info[infoCapacity];
+        std::size_t infoSize {};
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        std::string buildInfo()
+        {
+            std::string res;
+            res += "srcBranch           : " + std::string{dci::integration::info::srcBranch()} + '\n';
+            res += "srcRevision         : " + std::string{dci::integration::info::srcRevision()} + '\n';
+            res += "platformOs          : " + std::string{dci::integration::info::platformOs()} + '\n';
+            res += "platformArch        : " + std::string{dci::integration::info::platformArch()} + '\n';
+            res += "compiler            : " + std::string{dci::integration::info::compiler()} + '\n';
+            res += "compilerVersion     : " + std::string{dci::integration::info::compilerVersion()} + '\n';
+            res += "compilerOptimization: " + std::string{dci::integration::info::compilerOptimization()} + '\n';
+            res += "provider            : " + std::string{dci::integration::info::provider()} + '\n';
+            return res;
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        const char* stateName(dci::cmt::task::State state)
+        {
+            switch(state)
+            {
+            case dci::cmt::task::State::null : return "null";
+            case dci::cmt::task::State::ready: return "ready";
+            case dci::cmt::task::State::work : return "work";
+            case dci::cmt::task::State::hold : return "hold";
+            default: break;
+            }
+
+            return "unknown";
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void directory(const std::string& directory)
+    {
+        std::size_t size = std::min(directory.size(), pathCapacity - 64);
+        std::memcpy(dumpDirectory, directory.data(), size);
+        dumpDirectory[size] = 0;
+    }
+}
+
+#ifndef _WIN32
+namespace dci::host::crashDump
+{
+    namespace
+    {
+        constexpr std::size_t lineCapacity      = 8192;
+        constexpr std::size_t framesCapacity    = 128;
+        constexpr std::size_t altStackSize      = 256 * 1024;
+
+        char path[pathCapacity];
+
+        //два буфера: обновление идет в неактивный, обработчик всегда видит целую таблицу
+        struct Objects
+        {
+            char        _text[objectsCapacity];
+            std::size_t _size {};
+        };
+        Objects             objects[2];
+        std::atomic<int>    objectsCurrent {0};
+
+        boost::stacktrace::frame::native_frame_ptr_t frames[framesCapacity];
+        alignas(16) char    altStack[altStackSize];
+        std::atomic_flag    busy = ATOMIC_FLAG_INIT;
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //накопление в статическом буфере и сброс write(2), без выделений
+        struct Writer
+        {
+            int         _fd;
+            char        _buf[lineCapacity];
+            std::size_t _size {};
+
+            void flush()
+            {
+                const char* p = _buf;
+                while(_size)
+                {
+                    ssize_t w = ::write(_fd, p, _size);
+                    if(0 > w)
+                    {
+                        if(EINTR == errno)
+                        {
+                            continue;
+                        }
+                        break;
+                    }
+                    p += w;
+                    _size -= static_cast<std::size_t>(w);
+                }
+                _size = 0;
+            }
+
+            void put(const char* s, std::size_t n)
+            {
+                while(n)
+                {
+                    if(_size == lineCapacity)
+                    {
+                        flush();
+                    }
+
+                    std::size_t chunk = std::min(n, lineCapacity - _size);
+                    std::memcpy(_buf + _size, s, chunk);
+                    _size += chunk;
+                    s += chunk;
+                    n -= chunk;
+                }
+            }
+
+            void put(const char* s)
+            {
+                put(s, std::strlen(s));
+            }
+
+            void putDec(unsigned long long v)
+            {
+                char tmp[24];
+                char* end = tmp + sizeof(tmp);
+                char* p = end;
+                do
+                {
+                    *--p = static_cast<char>('0' + v % 10);
+                    v /= 10;
+                }
+                while(v);
+                put(p, static_cast<std::size_t>(end - p));
+            }
+
+            void putHex(std::uintptr_t v)
+            {
+                static constexpr char digits[] = "0123456789abcdef";
+                char tmp[2 + sizeof(v)*2];
+                char* end = tmp + sizeof(tmp);
+                char* p = end;
+                do
+                {
+                    *--p = digits[v & 0xf];
+                    v >>= 4;
+                }
+                while(v);
+                *--p = 'x';
+                *--p = '0';
+                put(p, static_cast<std::size_t>(end - p));
+            }
+        };
+        Writer writer {-1, {}, 0};
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        void append(char* buf, std::size_t& size, const char* s)
+        {
+            std::size_t n = std::min(std::strlen(s), pathCapacity - 1 - size);
+            std::memcpy(buf + size, s, n);
+            size += n;
+            buf[size] = 0;
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        void appendDec(char* buf, std::size_t& size, unsigned long long v)
+        {
+            char tmp[24];
+            char* p = tmp + sizeof(tmp);
+            *--p = 0;
+            do
+            {
+                *--p = static_cast<char>('0' + v % 10);
+                v /= 10;
+            }
+            while(v);
+            append(buf, size, p);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void setup(const std::string& dir)
+    {
+        directory(dir);
+
+        std::string i = buildInfo();
+        infoSize = std::min(i.size(), infoCapacity);
+        std::memcpy(info, i.data(), infoSize);
+
+        refreshObjects();
+
+        //первый вызов раскрутки подгружает libgcc_s, в обработчике этого делать нельзя
+        boost::stacktrace::safe_dump_to(frames, sizeof(frames));
+
+        stack_t ss {};
+        ss.ss_sp = altStack;
+        ss.ss_size = sizeof(altStack);
+        ss.ss_flags = 0;
+        sigaltstack(&ss, nullptr);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void refreshObjects()
+    {
+        Objects& target = objects[1 - objectsCurrent.load()];
+        target._size = 0;
+
+        dl_iterate_phdr([](struct dl_phdr_info *info, size_t /*size*/, void *data) -> int
+        {
+            Objects& target = *static_cast<Objects*>(data);
+
+            ///////////////////////////////////////////////
+            const char *soName = info->dlpi_name;
+            char exe[PATH_MAX];
+            if(!soName || !soName[0])
+            {
+                ssize_t ret = readlink("/proc/self/exe", exe, sizeof(exe)-1);
+                if(ret >= 0)
+                {
+                    exe[ret] = 0;
+                    soName = exe;
+                }
+            }
+
+            ///////////////////////////////////////////////
+            struct BuildIdNote
+            {
+                ElfW(Nhdr)  _nhdr;
+                char        _name[4];
+                uint8_t     _data[1];
+            };
+            BuildIdNote* buildIdNote{};
+
+            for(std::size_t i{}; i < info->dlpi_phnum && !buildIdNote; ++i)
+            {
+                if(PT_NOTE != info->dlpi_phdr[i].p_type)
+                {
+                    continue;
+                }
+
+                BuildIdNote* note = (BuildIdNote*)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+                std::size_t len = info->dlpi_phdr[i].p_filesz;
+
+                while(len >= sizeof(BuildIdNote))
+                {
+                    if (note->_nhdr.n_type == NT_GNU_BUILD_ID &&
+                        note->_nhdr.n_descsz != 0 &&
+                        note->_nhdr.n_namesz == 4 &&
+                        memcmp(note->_name, "GNU", 4) == 0)
+                    {
+                        buildIdNote = note;
+                        break;
+                    }
+
+                    auto align = [](std::size_t val, std::size_t align)
+                    {
+                        return (((val) + (align) - 1) & ~((align) - 1));
+                    };
+
+                    std::size_t offset = sizeof(ElfW(Nhdr)) +
+                                    align(note->_nhdr.n_namesz, 4) +
+                                    align(note->_nhdr.n_descsz, 4);
+                    if(offset > len)
+                    {
+                        break;
+                    }
+                    note = (BuildIdNote*)((char*)note + offset);
+                    len -= offset;
+                }
+            }
+
+            ///////////////////////////////////////////////
+            char addr[32];
+            std::snprintf(addr, sizeof(addr), "%p", reinterpret_cast<const void*>(info->dlpi_addr));
+            std::string line = std::string{addr} + " " + (soName ? soName : "");
+            if(buildIdNote)
+            {
+                line += " " + dci::utils::b2h(buildIdNote->_data, buildIdNote->_nhdr.n_descsz, dci::utils::HexEndian::middle);
+            }
+            line += '\n';
+
+            std::size_t n = std::min(line.size(), objectsCapacity - target._size);
+            std::memcpy(target._text + target._size, line.data(), n);
+            target._size += n;
+            return 0;
+        }, &target);
+
+        objectsCurrent.store(1 - objectsCurrent.load());
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void useAltStack(int signum)
+    {
+        struct sigaction sa {};
+        if(sigaction(signum, nullptr, &sa))
+        {
+            return;
+        }
+
+        if(!(sa.sa_flags & SA_SIGINFO) && (SIG_DFL == sa.sa_handler || SIG_IGN == sa.sa_handler))
+        {
+            return;
+        }
+
+        sa.sa_flags |= SA_ONSTACK;
+        sigaction(signum, &sa, nullptr);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void write(int signum)
+    {
+        //повторный сигнал во время записи, в том числе из другого потока, пропускается
+        if(busy.test_and_set())
+        {
+            return;
+        }
+
+        timespec ts {};
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        std::size_t pathSize {};
+        path[0] = 0;
+        append(path, pathSize, dumpDirectory);
+        append(path, pathSize, "/dci-host.");
+        appendDec(path, pathSize, static_cast<unsigned long long>(getpid()));
+        append(path, pathSize, ".");
+        appendDec(path, pathSize, static_cast<unsigned long long>(ts.tv_sec));
+        append(path, pathSize, ".crash");
+
+        int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(0 > fd)
+        {
+            busy.clear();
+            return;
+        }
+
+        Writer& w = writer;
+        w._fd = fd;
+        w._size = 0;
+
+        w.put("signal              : ");
+        w.putDec(static_cast<unsigned long long>(signum));
+        w.put("\npid                 : ");
+        w.putDec(static_cast<unsigned long long>(getpid()));
+        w.put("\ntime                : ");
+        w.putDec(static_cast<unsigned long long>(ts.tv_sec));
+        w.put("\n");
+        w.put(info, infoSize);
+
+        w.put("shared objects\n");
+        const Objects& o = objects[objectsCurrent.load()];
+        w.put(o._text, o._size);
+
+        //функция вызывается в контексте каждого волокна
+        dci::cmt::enumerateFibers([](dci::cmt::task::State state, void* data)
+        {
+            Writer& w = *static_cast<Writer*>(data);
+
+            w.put("ctx[");
+            w.put(stateName(state));
+            w.put("]");
+
+            std::size_t amount = boost::stacktrace::safe_dump_to(frames, sizeof(frames));
+            for(std::size_t i{}; i<amount && frames[i]; ++i)
+            {
+                w.put(" ");
+                w.putHex(reinterpret_cast<std::uintptr_t>(frames[i]));
+            }
+            w.put("\n");
+        }, &w);
+
+        w.flush();
+        ::close(fd);
+
+        w._fd = STDERR_FILENO;
+        w.put("crash dump: ");
+        w.put(path, pathSize);
+        w.put("\n");
+        w.flush();
+
+        busy.clear();
+    }
+}
+
+#else
+namespace dci::host::crashDump
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void setup(const std::string& dir)
+    {
+        directory(dir);
+
+        std::string i = buildInfo();
+        infoSize = std::min(i.size(), infoCapacity);
+        std::memcpy(info, i.data(), infoSize);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void refreshObjects()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void useAltStack(int)
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    //здесь обработчики исполняются в отдельном потоке, ограничения обработчиков сигналов POSIX не действуют
+    void write(int signum)
+    {
+        namespace fs = std::filesystem;
+
+        fs::path path = fs::path{dumpDirectory} / ("dci-host." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(time(nullptr)) + ".crash");
+        std::ofstream out{path};
+
+        if(!out)
+        {
+            return;
+        }
+
+        out << "signal              : " << signum << '\n';
+        out.write(info, static_cast<std::streamsize>(infoSize));
+
+        out << "modules" << std::endl;
+        std::vector<HMODULE> hMods;
+        hMods.resize(32);
+        DWORD cbNeeded = 0;
+        HANDLE hProcess = GetCurrentProcess();
+        while(EnumProcessModules(hProcess, hMods.data(), hMods.size()*sizeof(HMODULE), &cbNeeded) && cbNeeded > hMods.size()*sizeof(HMODULE))
+        {
+            hMods.resize(cbNeeded/sizeof(HMODULE));
+        }
+
+        for(DWORD i{}; i < (cbNeeded/sizeof(HMODULE)); i++)
+        {
+            fs::path modName;
+            WCHAR szModName[MAX_PATH];
+
+            if(GetModuleFileNameExW(hProcess, hMods[i], szModName, sizeof(szModName) / sizeof(WCHAR)))
+            {
+                modName = fs::path{szModName};
+            }
+
+            ///////////////////////////////////////////////
+            out << reinterpret_cast<const void*>(hMods[i]) << " " << modName.string();
+
+            bool idFetched = false;
+            if(!idFetched)
+            {
+                const char *image = (const char *)hMods[i];
+                IMAGE_DOS_HEADER* dosHeader = (IMAGE_DOS_HEADER*)image;
+                IMAGE_NT_HEADERS* ntHeaders = (IMAGE_NT_HEADERS*)&image[dosHeader->e_lfanew];
+                for(WORD sectionIndex{}; sectionIndex < ntHeaders->FileHeader.NumberOfSections; ++sectionIndex)
+                {
+                    IMAGE_SECTION_HEADER* section = (IMAGE_SECTION_HEADER*)&image[dosHeader->e_lfanew + sizeof(IMAGE_NT_HEADERS) + sectionIndex*sizeof(IMAGE_SECTION_HEADER)];
+                    if(section->Misc.VirtualSize < 48)
+                    {
+                        continue;
+                    }
+
+                    if(strncmp((const char*)&section->Name[0], ".buildid", IMAGE_SIZEOF_SHORT_NAME))
+                    {
+                        continue;
+                    }
+
+                    const dci::uint32 type = *(const dci::uint32*)&image[section->VirtualAddress + 28];
+                    if(0x53445352 != type)//RSDS
+                    {
+                        continue;
+                    }
+
+                    const dci::byte* hash = (const dci::byte*)&image[section->VirtualAddress + 32];
+                    out << " gnu:";
+                    out << dci::utils::b2h(hash+0, 4, dci::utils::HexEndian::big);
+                    out << dci::utils::b2h(hash+4, 2, dci::utils::HexEndian::big);
+                    out << dci::utils::b2h(hash+6, 2, dci::utils::HexEndian::big);
+                    out << dci::utils::b2h(hash+8, 8, dci::utils::HexEndian::middle);
+                    idFetched = true;
+                    break;
+                }
+            }
+
+            if(!idFetched)
+            {
+                SYMSRV_INDEX_INFOW info{};
+                info.sizeofstruct = sizeof(info);
+                if(SymSrvGetFileIndexInfoW(szModName, &info, 0))
+                {
+                    out << " ms:";
+                    char buf[64];
+                    std::sprintf(buf, "%lx%lx", info.timestamp, info.size);
+                    out << buf;
+                    idFetched = true;
+                }
+            }
+            out << std::endl;
+        }
+
+        dci::cmt::enumerateFibers([](dci::cmt::task::State state, void *data)
+        {
+            std::ofstream& out = *static_cast<std::ofstream*>(data);
+
+            out << "ctx[" << stateName(state) << "]";
+
+            boost::stacktrace::stacktrace st{};
+            for(const boost::stacktrace::frame& frame : st)
+            {
+                out << ' ' << frame.address();
+            }
+            out << '\n';
+        }, &out);
+
+        out.close();
+    }
+}
+#endif
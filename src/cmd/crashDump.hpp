@@ -0,0 +1,27 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <string>
+
+//снимок стеков всех волокон в файл <directory>/dci-host.<pid>.<unix time>.crash
+//write пригоден для вызова из обработчика сигнала: ничего не выделяет и не блокирует, только write(2)
+namespace dci::host::crashDump
+{
+    //вне обработчиков: буферы, альтернативный стек сигналов, сведения о сборке, таблица загруженных объектов
+    void setup(const std::string& directory);
+    void directory(const std::string& directory);
+
+    //новый снимок таблицы загруженных объектов с build-id, например после загрузки модулей
+    void refreshObjects();
+
+    //для уже установленного обработчика signum включает работу на альтернативном стеке
+    void useAltStack(int signum);
+
+    void write(int signum);
+}
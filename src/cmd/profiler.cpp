@@ -0,0 +1,383 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "profiler.hpp"
+#include <dci/logger.hpp>
+
+#if defined(__linux__)
+#   include <boost/stacktrace.hpp>
+#   include <boost/core/demangle.hpp>
+#   include <algorithm>
+#   include <atomic>
+#   include <cerrno>
+#   include <chrono>
+#   include <cstring>
+#   include <filesystem>
+#   include <fstream>
+#   include <map>
+#   include <sstream>
+#   include <thread>
+#   include <dlfcn.h>
+#   include <signal.h>
+#   include <time.h>
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#   define DCI_HOST_PROFILER 1
+#   ifndef sigev_notify_thread_id
+#       define sigev_notify_thread_id _sigev_un._tid
+#   endif
+#endif
+
+namespace dci::host::profiler
+{
+#ifdef DCI_HOST_PROFILER
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+        constexpr std::size_t depthMax = 64;
+        constexpr std::size_t ringSize = 4096;
+        static_assert(!(ringSize & (ringSize-1)));
+
+        //один писатель (обработчик в потоке цикла), один читатель (фоновый поток)
+        struct Sample
+        {
+            std::size_t                                     _depth;
+            boost::stacktrace::frame::native_frame_ptr_t    _frames[depthMax];
+        };
+        Sample                      ring[ringSize];
+        std::atomic<std::size_t>    head {};
+        std::atomic<std::size_t>    tail {};
+        std::atomic<std::size_t>    dropped {};
+
+        std::string                 dumpDirectory = fs::temp_directory_path().string();
+        std::size_t                 hz = 99;
+
+        bool                        running {};
+        timer_t                     timer {};
+        struct sigaction            previousAction {};
+        std::thread                 writer;
+        std::atomic<bool>           writerStop {};
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        void onSignal(int, siginfo_t*, void*)
+        {
+            int savedErrno = errno;
+
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if(h - tail.load(std::memory_order_acquire) >= ringSize)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                Sample& s = ring[h & (ringSize-1)];
+                s._depth = boost::stacktrace::safe_dump_to(1, s._frames, sizeof(s._frames));
+                head.store(h+1, std::memory_order_release);
+            }
+
+            errno = savedErrno;
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        struct Frame
+        {
+            std::string _name;
+            std::string _owner;//модуль, если кадр принадлежит его бинарнику
+        };
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        class Aggregator
+        {
+        public:
+            Aggregator()
+            {
+                std::error_code ec;
+                _modulesDir = fs::weakly_canonical(fs::current_path() / "../module", ec).string();
+            }
+
+            void drain()
+            {
+                std::size_t t = tail.load(std::memory_order_relaxed);
+                std::size_t h = head.load(std::memory_order_acquire);
+
+                for(; t != h; ++t)
+                {
+                    consume(ring[t & (ringSize-1)]);
+                    tail.store(t+1, std::memory_order_release);
+                }
+            }
+
+            void flush()
+            {
+                for(auto& [owner, stacks] : _owners)
+                {
+                    fs::path path = fs::path{dumpDirectory} / ("dci-host." + std::to_string(getpid()) + "." + owner + ".folded");
+                    std::ofstream out{path, std::ios::trunc};
+                    if(!out)
+                    {
+                        LOGW("profiler: unable to write "<<path);
+                        continue;
+                    }
+
+                    for(const auto& [stack, count] : stacks)
+                    {
+                        out << stack << ' ' << count << '\n';
+                    }
+                }
+
+                if(std::size_t d = dropped.exchange(0))
+                {
+                    LOGW("profiler: "<<d<<" samples dropped, ring is full");
+                }
+            }
+
+        private:
+            void consume(const Sample& s)
+            {
+                std::string stack;
+                std::string owner;
+
+                for(std::size_t i{std::min(s._depth, depthMax)}; i; --i)
+                {
+                    if(!s._frames[i-1])
+                    {
+                        continue;
+                    }
+
+                    const Frame& f = frame(s._frames[i-1]);
+                    if(!f._owner.empty())
+                    {
+                        //ближайший к вершине кадр модуля
+                        owner = f._owner;
+                    }
+
+                    if(!stack.empty())
+                    {
+                        stack += ';';
+                    }
+                    stack += f._name;
+                }
+
+                if(!stack.empty())
+                {
+                    ++_owners[owner.empty() ? "host" : owner][stack];
+                }
+            }
+
+            const Frame& frame(const void* addr)
+            {
+                auto iter = _frames.find(addr);
+                if(_frames.end() != iter)
+                {
+                    return iter->second;
+                }
+
+                Frame f;
+                Dl_info info {};
+                if(dladdr(addr, &info))
+                {
+                    if(info.dli_sname)
+                    {
+                        f._name = boost::core::demangle(info.dli_sname);
+                    }
+                    else
+                    {
+                        std::ostringstream name;
+                        name << fs::path{info.dli_fname ? info.dli_fname : ""}.filename().string() << "+0x" << std::hex
+                             << (static_cast<const char*>(addr) - static_cast<const char*>(info.dli_fbase));
+                        f._name = name.str();
+                    }
+
+                    if(info.dli_fname && !_modulesDir.empty())
+                    {
+                        std::error_code ec;
+                        fs::path object = fs::weakly_canonical(info.dli_fname, ec);
+                        if(!ec && object.string().starts_with(_modulesDir))
+                        {
+                            f._owner = object.stem().string();
+                        }
+                    }
+                }
+                else
+                {
+                    std::ostringstream name;
+                    name << addr;
+                    f._name = name.str();
+                }
+
+                std::replace(f._name.begin(), f._name.end(), ';', ':');
+                std::replace(f._name.begin(), f._name.end(), ' ', '_');
+
+                return _frames.emplace(addr, std::move(f)).first->second;
+            }
+
+        private:
+            std::string                                                 _modulesDir;
+            std::map<const void*, Frame>                                _frames;
+            std::map<std::string, std::map<std::string, std::size_t>>   _owners;
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void directory(const std::string& directory)
+    {
+        dumpDirectory = directory;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void frequency(std::size_t v)
+    {
+        hz = std::clamp(v, std::size_t{1}, std::size_t{10000});
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool start()
+    {
+        if(running)
+        {
+            return true;
+        }
+
+        //первый вызов раскрутки подгружает libgcc_s, в обработчике этого делать нельзя
+        {
+            Sample s;
+            boost::stacktrace::safe_dump_to(s._frames, sizeof(s._frames));
+        }
+
+        struct sigaction sa {};
+        sa.sa_sigaction = &onSignal;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if(sigaction(SIGPROF, &sa, &previousAction))
+        {
+            LOGE("profiler: sigaction: "<<strerror(errno));
+            return false;
+        }
+
+        //сигнал адресуется только потоку цикла
+        sigevent sev {};
+        sev.sigev_notify = SIGEV_THREAD_ID;
+        sev.sigev_signo = SIGPROF;
+        sev.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+        if(timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &timer))
+        {
+            LOGE("profiler: timer_create: "<<strerror(errno));
+            sigaction(SIGPROF, &previousAction, nullptr);
+            return false;
+        }
+
+        head = 0;
+        tail = 0;
+        dropped = 0;
+        writerStop = false;
+        //наследует привязку потока цикла (--cpus): просыпается раз в 50мс и процессор у цикла почти не отнимает
+        writer = std::thread{[]
+        {
+            Aggregator aggregator;
+            auto lastFlush = std::chrono::steady_clock::now();
+
+            while(!writerStop.load())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{50});
+                aggregator.drain();
+
+                if(std::chrono::steady_clock::now() - lastFlush >= std::chrono::seconds{1})
+                {
+                    aggregator.flush();
+                    lastFlush = std::chrono::steady_clock::now();
+                }
+            }
+
+            aggregator.drain();
+            aggregator.flush();
+        }};
+
+        long interval = 1000000000L / static_cast<long>(hz);
+        itimerspec its {};
+        its.it_interval.tv_sec = interval / 1000000000L;
+        its.it_interval.tv_nsec = interval % 1000000000L;
+        its.it_value = its.it_interval;
+        timer_settime(timer, 0, &its, nullptr);
+
+        running = true;
+        LOGI("profiler started, "<<hz<<" Hz, output to "<<dumpDirectory);
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void stop()
+    {
+        if(!running)
+        {
+            return;
+        }
+        running = false;
+
+        //сначала SIG_IGN: еще не доставленный SIGPROF отбрасывается, а не попадает в прежний (часто SIG_DFL, завершение процесса)
+        struct sigaction ignore {};
+        ignore.sa_handler = SIG_IGN;
+        sigemptyset(&ignore.sa_mask);
+        sigaction(SIGPROF, &ignore, nullptr);
+
+        timer_delete(timer);
+        sigaction(SIGPROF, &previousAction, nullptr);
+
+        writerStop = true;
+        writer.join();
+
+        LOGI("profiler stopped");
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool active()
+    {
+        return running;
+    }
+#else
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void directory(const std::string&)
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void frequency(std::size_t)
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool start()
+    {
+        LOGW("profiler is not supported on this platform");
+        return false;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void stop()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool active()
+    {
+        return false;
+    }
+#endif
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void toggle()
+    {
+        if(active())
+        {
+            stop();
+        }
+        else
+        {
+            start();
+        }
+    }
+}
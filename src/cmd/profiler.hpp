@@ -0,0 +1,25 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//выборочный профилировщик потока цикла: SIGPROF по процессорному времени, стек текущего волокна в кольцо без блокировок,
+//фоновый поток сворачивает стеки по модулю-владельцу в <directory>/dci-host.<pid>.<owner>.folded
+namespace dci::host::profiler
+{
+    void directory(const std::string& directory);
+    void frequency(std::size_t hz);
+
+    //вызываются из потока цикла, он и профилируется
+    bool start();
+    void stop();
+    bool active();
+    void toggle();
+}
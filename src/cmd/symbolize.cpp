@@ -0,0 +1,481 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "symbolize.hpp"
+#include <dci/logger.hpp>
+#include <dci/utils/b2h.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if __has_include(<elf.h>)
+#   include <elf.h>
+#   define DCI_HOST_SYMBOLIZE_ELF 1
+#endif
+
+#ifdef _WIN32
+#   define popen _popen
+#   define pclose _pclose
+#endif
+
+namespace dci::host
+{
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+        struct Object
+        {
+            std::uintptr_t  _base {};
+            std::string     _path;
+            std::string     _buildId;
+            fs::path        _binary;
+        };
+
+        struct Stack
+        {
+            std::string                 _state;
+            std::vector<std::uintptr_t> _frames;
+        };
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        std::uintptr_t parseAddress(const std::string& s)
+        {
+            try
+            {
+                return static_cast<std::uintptr_t>(std::stoull(s, nullptr, 16));
+            }
+            catch(...)
+            {
+                return 0;
+            }
+        }
+
+#ifdef DCI_HOST_SYMBOLIZE_ELF
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        template <class Ehdr, class Phdr, class Nhdr>
+        std::string elfBuildId(std::ifstream& in)
+        {
+            Ehdr ehdr;
+            in.seekg(0);
+            if(!in.read(reinterpret_cast<char*>(&ehdr), sizeof(ehdr)))
+            {
+                return {};
+            }
+
+            for(std::size_t i{}; i<ehdr.e_phnum; ++i)
+            {
+                Phdr phdr;
+                in.seekg(static_cast<std::streamoff>(ehdr.e_phoff + i * ehdr.e_phentsize));
+                if(!in.read(reinterpret_cast<char*>(&phdr), sizeof(phdr)))
+                {
+                    return {};
+                }
+
+                if(PT_NOTE != phdr.p_type || phdr.p_filesz > (1u<<20))
+                {
+                    continue;
+                }
+
+                std::vector<char> notes(phdr.p_filesz);
+                in.seekg(static_cast<std::streamoff>(phdr.p_offset));
+                if(!in.read(notes.data(), static_cast<std::streamsize>(notes.size())))
+                {
+                    return {};
+                }
+
+                auto align = [](std::size_t v){ return (v + 3) & ~std::size_t{3}; };
+
+                std::size_t pos {};
+                while(pos + sizeof(Nhdr) <= notes.size())
+                {
+                    const Nhdr* nhdr = reinterpret_cast<const Nhdr*>(notes.data() + pos);
+                    std::size_t name = pos + sizeof(Nhdr);
+                    std::size_t desc = name + align(nhdr->n_namesz);
+                    std::size_t next = desc + align(nhdr->n_descsz);
+                    if(desc + nhdr->n_descsz > notes.size())
+                    {
+                        break;
+                    }
+
+                    if(NT_GNU_BUILD_ID == nhdr->n_type && 4 == nhdr->n_namesz && !memcmp(notes.data() + name, "GNU", 4) && nhdr->n_descsz)
+                    {
+                        return dci::utils::b2h(notes.data() + desc, nhdr->n_descsz, dci::utils::HexEndian::middle);
+                    }
+
+                    pos = next;
+                }
+            }
+
+            return {};
+        }
+#endif
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        std::string fileBuildId(const fs::path& path)
+        {
+#ifdef DCI_HOST_SYMBOLIZE_ELF
+            std::ifstream in{path, std::ios::binary};
+            unsigned char ident[EI_NIDENT];
+            if(!in.read(reinterpret_cast<char*>(ident), sizeof(ident)) || memcmp(ident, ELFMAG, SELFMAG))
+            {
+                return {};
+            }
+
+            switch(ident[EI_CLASS])
+            {
+            case ELFCLASS64: return elfBuildId<Elf64_Ehdr, Elf64_Phdr, Elf64_Nhdr>(in);
+            case ELFCLASS32: return elfBuildId<Elf32_Ehdr, Elf32_Phdr, Elf32_Nhdr>(in);
+            default: break;
+            }
+#else
+            (void)path;
+#endif
+            return {};
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //build-id -> файл по каталогам поиска, строится один раз по требованию
+        class Locator
+        {
+        public:
+            Locator()
+            {
+                for(const char* sub : {"../module", "../lib"})
+                {
+                    _dirs.emplace_back(fs::current_path() / sub);
+                }
+            }
+
+            fs::path locate(const Object& o)
+            {
+                fs::path recorded{o._path};
+
+                std::vector<fs::path> candidates;
+                for(const fs::path& dir : _dirs)
+                {
+                    candidates.emplace_back(dir / recorded.filename());
+                }
+                candidates.emplace_back(recorded);
+
+                for(const fs::path& c : candidates)
+                {
+                    std::error_code ec;
+                    if(c.empty() || !fs::is_regular_file(c, ec))
+                    {
+                        continue;
+                    }
+
+                    if(o._buildId.empty() || fileBuildId(c) == o._buildId)
+                    {
+                        return c;
+                    }
+                }
+
+                if(o._buildId.empty())
+                {
+                    return {};
+                }
+
+                index();
+                auto iter = _byBuildId.find(o._buildId);
+                return _byBuildId.end() == iter ? fs::path{} : iter->second;
+            }
+
+        private:
+            void index()
+            {
+                if(_indexed)
+                {
+                    return;
+                }
+                _indexed = true;
+
+                for(const fs::path& dir : _dirs)
+                {
+                    std::error_code ec;
+                    for(fs::recursive_directory_iterator iter{dir, ec}, end; !ec && iter != end; iter.increment(ec))
+                    {
+                        if(!iter->is_regular_file(ec))
+                        {
+                            continue;
+                        }
+
+                        std::string id = fileBuildId(iter->path());
+                        if(!id.empty())
+                        {
+                            _byBuildId.emplace(std::move(id), iter->path());
+                        }
+                    }
+                }
+            }
+
+        private:
+            std::vector<fs::path>               _dirs;
+            bool                                _indexed {};
+            std::map<std::string, fs::path>     _byBuildId;
+        };
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        std::string shellQuote(const std::string& s)
+        {
+            std::string res{"'"};
+            for(char c : s)
+            {
+                if('\'' == c)
+                {
+                    res += "'\\''";
+                }
+                else
+                {
+                    res += c;
+                }
+            }
+            res += '\'';
+            return res;
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //addr2line пачками, по две строки на адрес: функция и файл:строка
+        void resolve(const fs::path& binary, const std::vector<std::uintptr_t>& offsets, std::map<std::uintptr_t, std::string>& names)
+        {
+            constexpr std::size_t chunk = 256;
+
+            for(std::size_t from{}; from < offsets.size(); from += chunk)
+            {
+                std::size_t to = std::min(offsets.size(), from + chunk);
+
+                std::ostringstream cmd;
+                cmd << "addr2line -C -f -e " << shellQuote(binary.string()) << std::hex;
+                for(std::size_t i{from}; i<to; ++i)
+                {
+                    cmd << " 0x" << offsets[i];
+                }
+
+                FILE* pipe = popen(cmd.str().c_str(), "r");
+                if(!pipe)
+                {
+                    LOGE("symbolize: unable to run addr2line");
+                    return;
+                }
+
+                auto readLine = [&]
+                {
+                    std::string line;
+                    char buf[4096];
+                    while(fgets(buf, sizeof(buf), pipe))
+                    {
+                        line += buf;
+                        if(!line.empty() && '\n' == line.back())
+                        {
+                            line.pop_back();
+                            break;
+                        }
+                    }
+                    return line;
+                };
+
+                for(std::size_t i{from}; i<to; ++i)
+                {
+                    std::string function = readLine();
+                    std::string location = readLine();
+
+                    if(function.empty() || "??" == function)
+                    {
+                        continue;
+                    }
+
+                    std::string& name = names[offsets[i]];
+                    name = function;
+
+                    if(!location.empty() && '?' != location[0])
+                    {
+                        std::size_t discriminator = location.find(" (");
+                        if(std::string::npos != discriminator)
+                        {
+                            location.resize(discriminator);
+                        }
+                        name += " " + fs::path{location}.filename().string();
+                    }
+                }
+
+                pclose(pipe);
+            }
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        std::string folded(std::string s)
+        {
+            std::replace(s.begin(), s.end(), ';', ':');
+            return s;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    int symbolize(const std::string& dumpFile, std::ostream& out)
+    {
+        std::ifstream in{dumpFile};
+        if(!in)
+        {
+            LOGE("symbolize: unable to open "<<dumpFile);
+            return EXIT_FAILURE;
+        }
+
+        std::vector<Object> objects;
+        std::vector<Stack> stacks;
+
+        std::string line;
+        while(std::getline(in, line))
+        {
+            if(line.starts_with("ctx["))
+            {
+                std::size_t close = line.find(']');
+                if(std::string::npos == close)
+                {
+                    continue;
+                }
+
+                Stack& s = stacks.emplace_back();
+                s._state = line.substr(4, close - 4);
+
+                std::istringstream frames{line.substr(close + 1)};
+                std::string frame;
+                while(frames >> frame)
+                {
+                    s._frames.push_back(parseAddress(frame));
+                }
+                continue;
+            }
+
+            if(line.starts_with("0x"))
+            {
+                std::istringstream fields{line};
+                std::string base;
+                Object o;
+                fields >> base >> o._path >> o._buildId;
+                o._base = parseAddress(base);
+                objects.emplace_back(std::move(o));
+            }
+        }
+
+        if(stacks.empty())
+        {
+            LOGE("symbolize: no fiber stacks in "<<dumpFile);
+            return EXIT_FAILURE;
+        }
+
+        std::sort(objects.begin(), objects.end(), [](const Object& a, const Object& b){ return a._base < b._base; });
+
+        Locator locator;
+        for(Object& o : objects)
+        {
+            o._binary = locator.locate(o);
+            if(o._binary.empty())
+            {
+                LOGW("symbolize: binary not found for "<<o._path<<(o._buildId.empty() ? "" : " build-id ")<<o._buildId);
+            }
+        }
+
+        auto objectFor = [&](std::uintptr_t addr) -> Object*
+        {
+            auto iter = std::upper_bound(objects.begin(), objects.end(), addr, [](std::uintptr_t a, const Object& o){ return a < o._base; });
+            return objects.begin() == iter ? nullptr : &*std::prev(iter);
+        };
+
+        //адрес возврата указывает за инструкцию вызова, для всех кадров кроме самого глубокого берется предыдущий байт
+        auto lookupAddress = [](const Stack& s, std::size_t i)
+        {
+            return i && s._frames[i] ? s._frames[i] - 1 : s._frames[i];
+        };
+
+        std::map<Object*, std::vector<std::uintptr_t>> offsets;
+        for(const Stack& s : stacks)
+        {
+            for(std::size_t i{}; i<s._frames.size(); ++i)
+            {
+                std::uintptr_t addr = lookupAddress(s, i);
+                if(Object* o = objectFor(addr); o && !o->_binary.empty())
+                {
+                    offsets[o].push_back(addr - o->_base);
+                }
+            }
+        }
+
+        std::map<Object*, std::map<std::uintptr_t, std::string>> names;
+        for(auto& [o, v] : offsets)
+        {
+            std::sort(v.begin(), v.end());
+            v.erase(std::unique(v.begin(), v.end()), v.end());
+            resolve(o->_binary, v, names[o]);
+        }
+
+        auto frameName = [&](std::uintptr_t addr)
+        {
+            Object* o = objectFor(addr);
+            if(!o)
+            {
+                std::ostringstream res;
+                res << "0x" << std::hex << addr;
+                return res.str();
+            }
+
+            std::uintptr_t offset = addr - o->_base;
+            auto& objNames = names[o];
+            if(auto iter = objNames.find(offset); objNames.end() != iter)
+            {
+                return folded(iter->second);
+            }
+
+            std::ostringstream res;
+            res << fs::path{o->_path}.filename().string() << "+0x" << std::hex << offset;
+            return folded(res.str());
+        };
+
+        //порядок состояний как в снимке, внутри состояния одинаковые стеки схлопываются
+        std::vector<std::string> states;
+        std::map<std::string, std::map<std::string, std::size_t>> byState;
+        for(const Stack& s : stacks)
+        {
+            std::string key = s._state;
+            for(std::size_t i{s._frames.size()}; i; --i)
+            {
+                if(!s._frames[i-1])
+                {
+                    continue;
+                }
+                key += ';';
+                key += frameName(lookupAddress(s, i-1));
+            }
+
+            auto& group = byState[s._state];
+            if(group.empty())
+            {
+                states.push_back(s._state);
+            }
+            ++group[key];
+        }
+
+        for(const std::string& state : states)
+        {
+            std::vector<std::pair<std::string, std::size_t>> group{byState[state].begin(), byState[state].end()};
+            std::stable_sort(group.begin(), group.end(), [](const auto& a, const auto& b){ return a.second > b.second; });
+
+            for(const auto& [key, count] : group)
+            {
+                out << key << ' ' << count << '\n';
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
@@ -7,15 +7,78 @@
 
 #include "dll.hpp"
 #include <map>
+#include <mutex>
+
+#if __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
 
 namespace dci::host
 {
+    namespace
+    {
+        struct Slot
+        {
+            std::mutex                      _mtx;
+            boost::dll::shared_library      _sl;
+        };
+
+        std::mutex                      allMtx;
+        std::map<std::string, Slot>     all;
+    }
+
     boost::dll::shared_library& dll(const std::string path)
     {
-        static std::map<std::string, boost::dll::shared_library> all;
-        boost::dll::shared_library& sl = all[path];
+        Slot* slot;
+        {
+            std::lock_guard l{allMtx};
+            slot = &all[path];
+        }
+
+        std::lock_guard l{slot->_mtx};
+        boost::dll::shared_library& sl = slot->_sl;
         if(!sl.is_loaded())
             sl.load(path, boost::dll::load_mode::rtld_now | boost::dll::load_mode::rtld_local /*| boost::dll::load_mode::rtld_deepbind*/);
         return sl;
     }
+
+    void dllUnload(const std::string& path)
+    {
+        Slot* slot;
+        {
+            std::lock_guard l{allMtx};
+            auto iter = all.find(path);
+            if(all.end() == iter)
+            {
+                return;
+            }
+            slot = &iter->second;
+        }
+
+        std::lock_guard l{slot->_mtx};
+        slot->_sl.unload();
+    }
+
+    void dllPrefetch(const std::string& path)
+    {
+#if defined(POSIX_FADV_WILLNEED)
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(0 > fd)
+        {
+            return;
+        }
+
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+
+        //WILLNEED только заказывает чтение, дочитывание здесь делает вызов блокирующим до попадания в page cache
+        static thread_local char buf[1 << 16];
+        while(0 < ::read(fd, buf, sizeof(buf)));
+
+        ::close(fd);
+#else
+        (void)path;
+#endif
+    }
 }
@@ -9,5 +9,12 @@
 
 namespace dci::host
 {
+    //потокобезопасна, загрузки разных путей не сериализуются между собой
     boost::dll::shared_library& dll(const std::string path);
+
+    //dlclose, следующий dll(path) загрузит файл заново
+    void dllUnload(const std::string& path);
+
+    //чтение файла в page cache до dlopen, блокирующее
+    void dllPrefetch(const std::string& path);
 }
@@ -0,0 +1,151 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "elf.hpp"
+#include <bit>
+#include <cstring>
+
+#if __has_include(<elf.h>) && __has_include(<sys/mman.h>)
+#   include <elf.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   define DCI_HOST_ELF 1
+#endif
+
+namespace dci::host
+{
+#ifdef DCI_HOST_ELF
+    namespace
+    {
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        template <class Ehdr, class Shdr>
+        bool findSection(const char* image, std::size_t size, const std::string& sectionName, std::string& content)
+        {
+            if(size < sizeof(Ehdr))
+            {
+                return false;
+            }
+
+            Ehdr ehdr;
+            std::memcpy(&ehdr, image, sizeof(Ehdr));
+
+            if(!ehdr.e_shoff || sizeof(Shdr) != ehdr.e_shentsize || SHN_UNDEF == ehdr.e_shstrndx || ehdr.e_shstrndx >= ehdr.e_shnum)
+            {
+                return false;
+            }
+
+            if(ehdr.e_shoff > size || (size - ehdr.e_shoff) / sizeof(Shdr) < ehdr.e_shnum)
+            {
+                return false;
+            }
+
+            auto shdr = [&](std::size_t index)
+            {
+                Shdr res;
+                std::memcpy(&res, image + ehdr.e_shoff + index * sizeof(Shdr), sizeof(Shdr));
+                return res;
+            };
+
+            auto inImage = [&](const Shdr& s)
+            {
+                return s.sh_offset <= size && s.sh_size <= size - s.sh_offset;
+            };
+
+            const Shdr strtab = shdr(ehdr.e_shstrndx);
+            if(SHT_NOBITS == strtab.sh_type || !inImage(strtab))
+            {
+                return false;
+            }
+
+            const char* names = image + strtab.sh_offset;
+            for(std::size_t i{}; i<ehdr.e_shnum; ++i)
+            {
+                const Shdr s = shdr(i);
+                if(s.sh_name >= strtab.sh_size)
+                {
+                    continue;
+                }
+
+                const char* name = names + s.sh_name;
+                std::size_t nameMax = strtab.sh_size - s.sh_name;
+                if(strnlen(name, nameMax) != sectionName.size() || sectionName.compare(0, sectionName.size(), name, sectionName.size()))
+                {
+                    continue;
+                }
+
+                if(SHT_NOBITS == s.sh_type || !inImage(s))
+                {
+                    return false;
+                }
+
+                content.assign(image + s.sh_offset, s.sh_size);
+                return true;
+            }
+
+            return false;
+        }
+    }
+#endif
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool elfSection(const std::string& path, const std::string& sectionName, std::string& content)
+    {
+#ifdef DCI_HOST_ELF
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(0 > fd)
+        {
+            return false;
+        }
+
+        struct stat st;
+        if(::fstat(fd, &st) || st.st_size < EI_NIDENT)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if(MAP_FAILED == p)
+        {
+            return false;
+        }
+
+        const char* image = static_cast<const char*>(p);
+        bool res = false;
+
+        constexpr unsigned char nativeData = (std::endian::native == std::endian::little) ? ELFDATA2LSB : ELFDATA2MSB;
+
+        if(!std::memcmp(image, ELFMAG, SELFMAG) && nativeData == static_cast<unsigned char>(image[EI_DATA]))
+        {
+            switch(image[EI_CLASS])
+            {
+            case ELFCLASS64:
+                res = findSection<Elf64_Ehdr, Elf64_Shdr>(image, size, sectionName, content);
+                break;
+            case ELFCLASS32:
+                res = findSection<Elf32_Ehdr, Elf32_Shdr>(image, size, sectionName, content);
+                break;
+            default:
+                break;
+            }
+        }
+
+        ::munmap(p, size);
+        return res;
+#else
+        (void)path;
+        (void)sectionName;
+        (void)content;
+        return false;
+#endif
+    }
+}
@@ -0,0 +1,329 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/host/handoff.hpp>
+#include <dci/logger.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#   include <fcntl.h>
+#   include <unistd.h>
+#   define DCI_HOST_HANDOFF_POSIX 1
+#endif
+
+namespace dci::host::handoff
+{
+    namespace
+    {
+        //имя переменной окружения с описью: записи через ';', поля fd:owner:name:state, строки в hex
+        constexpr const char* envName = "DCI_HOST_HANDOFF";
+
+        struct Item
+        {
+            int         _fd {-1};
+            std::string _state;
+        };
+
+        using Key = std::pair<std::string, std::string>;
+
+        std::mutex              mtx;
+        std::map<Key, Item>     offered;    //в этом процессе, уйдут в следующий
+        std::map<Key, Item>     adopted;    //пришли из предыдущего
+
+        std::string toHex(std::string_view v)
+        {
+            static constexpr char digits[] = "0123456789abcdef";
+
+            std::string res;
+            res.reserve(v.size()*2);
+            for(unsigned char c : v)
+            {
+                res += digits[c >> 4];
+                res += digits[c & 0x0f];
+            }
+            return res;
+        }
+
+        bool fromHex(std::string_view v, std::string& res)
+        {
+            auto nibble = [](char c) -> int
+            {
+                if(c >= '0' && c <= '9') return c - '0';
+                if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+                return -1;
+            };
+
+            if(v.size() % 2)
+            {
+                return false;
+            }
+
+            res.clear();
+            res.reserve(v.size()/2);
+            for(std::size_t i{}; i<v.size(); i+=2)
+            {
+                int h = nibble(v[i]);
+                int l = nibble(v[i+1]);
+                if(0 > h || 0 > l)
+                {
+                    return false;
+                }
+                res += static_cast<char>(h << 4 | l);
+            }
+            return true;
+        }
+
+        void closeFd(int fd)
+        {
+#ifdef DCI_HOST_HANDOFF_POSIX
+            ::close(fd);
+#else
+            (void)fd;
+#endif
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool offer(const std::string& owner, const std::string& name, int fd, std::string_view state)
+    {
+#ifdef DCI_HOST_HANDOFF_POSIX
+        //копия с CLOEXEC, чтобы не утечь в посторонние exec до перезапуска
+        int dup = ::fcntl(fd, F_DUPFD_CLOEXEC, 3);
+        if(0 > dup)
+        {
+            LOGW("handoff: "<<owner<<"/"<<name<<": unable to dup: "<<strerror(errno));
+            return false;
+        }
+
+        std::lock_guard l{mtx};
+        Item& item = offered[Key{owner, name}];
+        if(0 <= item._fd)
+        {
+            closeFd(item._fd);
+        }
+        item._fd = dup;
+        item._state = state;
+        return true;
+#else
+        (void)owner;
+        (void)name;
+        (void)fd;
+        (void)state;
+        return false;
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void withdraw(const std::string& owner, const std::string& name)
+    {
+        std::lock_guard l{mtx};
+        auto iter = offered.find(Key{owner, name});
+        if(offered.end() != iter)
+        {
+            closeFd(iter->second._fd);
+            offered.erase(iter);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    int take(const std::string& owner, const std::string& name, std::string* state)
+    {
+        std::lock_guard l{mtx};
+        auto iter = adopted.find(Key{owner, name});
+        if(adopted.end() == iter)
+        {
+            return -1;
+        }
+
+        int fd = iter->second._fd;
+        if(state)
+        {
+            *state = std::move(iter->second._state);
+        }
+        adopted.erase(iter);
+
+#ifdef DCI_HOST_HANDOFF_POSIX
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+        return fd;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<std::string> pending(const std::string& owner)
+    {
+        std::vector<std::string> res;
+
+        std::lock_guard l{mtx};
+        for(auto iter = adopted.lower_bound(Key{owner, std::string{}}); adopted.end() != iter && owner == iter->first.first; ++iter)
+        {
+            res.push_back(iter->first.second);
+        }
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void adopt()
+    {
+        const char* env = std::getenv(envName);
+        if(!env)
+        {
+            return;
+        }
+
+        std::string_view inventory{env};
+        std::size_t amount {};
+
+        {
+            std::lock_guard l{mtx};
+            while(!inventory.empty())
+            {
+                std::size_t end = inventory.find(';');
+                std::string_view record = inventory.substr(0, end);
+                inventory = std::string_view::npos == end ? std::string_view{} : inventory.substr(end+1);
+
+                std::string_view fields[4];
+                std::size_t fieldsAmount {};
+                while(fieldsAmount < 4)
+                {
+                    std::size_t colon = record.find(':');
+                    fields[fieldsAmount++] = record.substr(0, colon);
+                    if(std::string_view::npos == colon)
+                    {
+                        break;
+                    }
+                    record = record.substr(colon+1);
+                }
+
+                Key key;
+                Item item;
+                if(4 != fieldsAmount ||
+                   !fromHex(fields[1], key.first) ||
+                   !fromHex(fields[2], key.second) ||
+                   !fromHex(fields[3], item._state))
+                {
+                    LOGW("handoff: malformed inventory record");
+                    continue;
+                }
+
+                item._fd = std::atoi(std::string{fields[0]}.c_str());
+                if(0 > item._fd)
+                {
+                    continue;
+                }
+
+#ifdef DCI_HOST_HANDOFF_POSIX
+                //до take не должен уходить в посторонние exec
+                ::fcntl(item._fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+                adopted[std::move(key)] = std::move(item);
+                ++amount;
+            }
+        }
+
+        //в последующие exec опись не уходит
+#ifdef DCI_HOST_HANDOFF_POSIX
+        ::unsetenv(envName);
+#endif
+
+        LOGI("handoff: "<<amount<<" descriptors adopted");
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool prepareExec()
+    {
+#ifdef DCI_HOST_HANDOFF_POSIX
+        std::string inventory;
+
+        std::lock_guard l{mtx};
+        for(const auto&[key, item] : offered)
+        {
+            if(0 > ::fcntl(item._fd, F_SETFD, 0))
+            {
+                LOGW("handoff: "<<key.first<<"/"<<key.second<<": "<<strerror(errno));
+                continue;
+            }
+
+            if(!inventory.empty())
+            {
+                inventory += ';';
+            }
+            inventory += std::to_string(item._fd) + ':' + toHex(key.first) + ':' + toHex(key.second) + ':' + toHex(item._state);
+        }
+
+        if(inventory.empty())
+        {
+            ::unsetenv(envName);
+            return true;
+        }
+
+        if(::setenv(envName, inventory.c_str(), 1))
+        {
+            LOGW("handoff: unable to set environment: "<<strerror(errno));
+            for(const auto&[key, item] : offered)
+            {
+                ::fcntl(item._fd, F_SETFD, FD_CLOEXEC);
+            }
+            return false;
+        }
+
+        LOGI("handoff: "<<offered.size()<<" descriptors prepared for restart");
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void execFailed()
+    {
+#ifdef DCI_HOST_HANDOFF_POSIX
+        std::lock_guard l{mtx};
+        for(const auto&[key, item] : offered)
+        {
+            ::fcntl(item._fd, F_SETFD, FD_CLOEXEC);
+        }
+
+        ::unsetenv(envName);
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t closeUnclaimed()
+    {
+        std::lock_guard l{mtx};
+
+        for(const auto&[key, item] : adopted)
+        {
+            LOGW("handoff: "<<key.first<<"/"<<key.second<<" is not claimed, closed");
+            closeFd(item._fd);
+        }
+
+        std::size_t res = adopted.size();
+        adopted.clear();
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t dropAdopted()
+    {
+        std::lock_guard l{mtx};
+
+        for(const auto&[key, item] : adopted)
+        {
+            closeFd(item._fd);
+        }
+
+        std::size_t res = adopted.size();
+        adopted.clear();
+        return res;
+    }
+}
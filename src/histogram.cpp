@@ -0,0 +1,129 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/host/histogram.hpp>
+#include <algorithm>
+#include <bit>
+
+namespace dci::host
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Histogram::add(std::uint64_t value, std::uint64_t times)
+    {
+        _buckets[bucketIndex(value)] += times;
+        _count += times;
+        _sum += value * times;
+        _min = std::min(_min, value);
+        _max = std::max(_max, value);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Histogram::merge(const Histogram& other)
+    {
+        for(std::size_t i{}; i<_bucketsAmount; ++i)
+        {
+            _buckets[i] += other._buckets[i];
+        }
+
+        _count += other._count;
+        _sum += other._sum;
+        _min = std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Histogram::reset()
+    {
+        *this = Histogram{};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t Histogram::count() const
+    {
+        return _count;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t Histogram::sum() const
+    {
+        return _sum;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t Histogram::min() const
+    {
+        return _count ? _min : 0;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t Histogram::max() const
+    {
+        return _max;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t Histogram::percentile(double p) const
+    {
+        if(!_count)
+        {
+            return 0;
+        }
+
+        p = std::clamp(p, 0.0, 1.0);
+        std::uint64_t rank = std::max(std::uint64_t{1}, static_cast<std::uint64_t>(p * static_cast<double>(_count) + 0.5));
+
+        std::uint64_t seen {};
+        for(std::size_t i{}; i<_bucketsAmount; ++i)
+        {
+            seen += _buckets[i];
+            if(seen >= rank)
+            {
+                return std::min(bucketUpper(i), _max);
+            }
+        }
+
+        return _max;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Histogram::Summary Histogram::summary() const
+    {
+        return Summary{_count, percentile(0.5), percentile(0.99), percentile(0.999), _max};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const std::array<std::uint64_t, Histogram::_bucketsAmount>& Histogram::buckets() const
+    {
+        return _buckets;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Histogram::bucketIndex(std::uint64_t value)
+    {
+        if(value < _subAmount)
+        {
+            return static_cast<std::size_t>(value);
+        }
+
+        std::size_t msb = static_cast<std::size_t>(std::bit_width(value)) - 1;
+        std::size_t shift = msb - _subBits;
+        return (shift + 1) * _subAmount + static_cast<std::size_t>((value >> shift) & (_subAmount - 1));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::uint64_t Histogram::bucketUpper(std::size_t index)
+    {
+        if(index < _subAmount)
+        {
+            return index;
+        }
+
+        std::size_t shift = index / _subAmount - 1;
+        std::uint64_t lower = (_subAmount + index % _subAmount) << shift;
+        return lower + ((std::uint64_t{1} << shift) - 1);
+    }
+}
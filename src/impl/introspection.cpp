@@ -0,0 +1,305 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "introspection.hpp"
+#include "manager.hpp"
+#include <fstream>
+
+#ifndef _WIN32
+#   include <unistd.h>
+#endif
+
+namespace dci::host::impl
+{
+    namespace
+    {
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        idl::host::introspection::ModuleState cnvt(Module::State state)
+        {
+            using S = idl::host::introspection::ModuleState;
+
+            switch(state)
+            {
+            case Module::State::null:           return S::null;
+            case Module::State::attached:       return S::attached;
+            case Module::State::attachError:    return S::attachError;
+            case Module::State::loading:        return S::loading;
+            case Module::State::loaded:         return S::loaded;
+            case Module::State::loadError:      return S::loadError;
+            case Module::State::unloading:      return S::unloading;
+            case Module::State::starting:       return S::starting;
+            case Module::State::started:        return S::started;
+            case Module::State::startError:     return S::startError;
+            case Module::State::stopping:       return S::stopping;
+            }
+
+            return S::null;
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        idl::host::introspection::Histogram cnvt(const Histogram& h)
+        {
+            Histogram::Summary s = h.summary();
+
+            idl::host::introspection::Histogram res;
+            res.count = s._count;
+            res.p50 = s._p50;
+            res.p99 = s._p99;
+            res.p999 = s._p999;
+            res.max = s._max;
+            return res;
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        idl::host::introspection::Change cnvt(Manager::Change change)
+        {
+            using C = idl::host::introspection::Change;
+
+            switch(change)
+            {
+            case Manager::Change::modules:  return C::modules;
+            case Manager::Change::services: return C::services;
+            case Manager::Change::daemons:  return C::daemons;
+            }
+
+            return C::modules;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Introspection::Introspection(Manager* manager)
+        : idl::gen::host::Introspection<>::Opposite(idl::interface::Initializer())
+        , _manager{manager}
+    {
+        //in modules() -> list<introspection::Module>;
+        methods()->modules() += sol() * [this]
+        {
+            return cmt::readyFuture(modules());
+        };
+
+        //in services() -> list<introspection::Service>;
+        methods()->services() += sol() * [this]
+        {
+            return cmt::readyFuture(services());
+        };
+
+        //in daemons() -> list<introspection::Daemon>;
+        methods()->daemons() += sol() * [this]
+        {
+            //состояния опрашиваются у самих демонов
+            return cmt::spawnv<List<idl::host::introspection::Daemon>>(_tol, [this]
+            {
+                return daemons();
+            });
+        };
+
+        //in timings() -> introspection::Timings;
+        methods()->timings() += sol() * [this]
+        {
+            return cmt::readyFuture(timings());
+        };
+
+        //in fibers() -> introspection::Fibers;
+        methods()->fibers() += sol() * [this]
+        {
+            return cmt::readyFuture(fibers());
+        };
+
+        //in memory() -> introspection::Memory;
+        methods()->memory() += sol() * [this]
+        {
+            return cmt::readyFuture(memory());
+        };
+
+        //out changed(introspection::Change);
+        _manager->changed() += sol() * [this](Manager::Change change)
+        {
+            methods()->changed(cnvt(change));
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Introspection::~Introspection()
+    {
+        sol().flush();
+        _tol.stop();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    uint64 Introspection::sinceRun(std::chrono::steady_clock::time_point moment) const
+    {
+        if(moment <= _manager->_runMoment)
+        {
+            return 0;
+        }
+
+        return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(moment - _manager->_runMoment).count());
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    List<idl::host::introspection::Module> Introspection::modules() const
+    {
+        List<idl::host::introspection::Module> res;
+        res.reserve(_manager->_modules.size());
+
+        for(const ModulePtr& module : _manager->_modules)
+        {
+            const module::Manifest& manifest = module->manifest();
+
+            idl::host::introspection::Module& m = res.emplace_back();
+            m.name = manifest._name;
+            m.mainBinary = manifest._mainBinary;
+            m.state = cnvt(module->state());
+            m.stateMoment = sinceRun(module->moments()._states[static_cast<std::size_t>(module->state())]);
+            m.stopRequested = module->stopRequested();
+            m.stopLocks = module->stopLocks();
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    List<idl::host::introspection::Service> Introspection::services() const
+    {
+        List<idl::host::introspection::Service> res;
+
+        const ServiceRegistry& registry = _manager->_services;
+        registry.forEachProvider([&](idl::ILid ilid, Module* module)
+        {
+            idl::host::introspection::Service& s = res.emplace_back();
+            s.iid = ilid.toIidText();
+            s.module = module->manifest()._name;
+
+            for(const ServiceRegistry::Alias& alias : registry.aliases())
+            {
+                if(ilid == alias.second)
+                {
+                    s.aliases.emplace_back(alias.first);
+                }
+            }
+        });
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    List<idl::host::introspection::Daemon> Introspection::daemons() const
+    {
+        List<idl::host::introspection::Daemon> res;
+        res.reserve(_manager->_daemons.size());
+
+        std::vector<cmt::Future<idl::host::daemon::State>> states;
+        states.reserve(_manager->_daemons.size());
+
+        for(const auto& [name, instance] : _manager->_daemons)
+        {
+            idl::host::introspection::Daemon& d = res.emplace_back();
+            d.name = name;
+            d.module = instance._module ? instance._module->manifest()._name : String{};
+            d.state = idl::host::daemon::State::null;
+
+            states.emplace_back(instance._daemon ? instance._daemon->state() : cmt::readyFuture(idl::host::daemon::State::null));
+        }
+
+        for(std::size_t i{}; i<states.size(); ++i)
+        {
+            if(!states[i].waitException())
+            {
+                res[i].state = states[i].detachValue();
+            }
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    idl::host::introspection::Timings Introspection::timings() const
+    {
+        idl::host::introspection::Timings res;
+        res.uptime = sinceRun(std::chrono::steady_clock::now());
+        res.modulesInitialized = sinceRun(_manager->_modulesInitializedMoment);
+
+        for(const Manager::DaemonMoments& dm : _manager->_daemonMoments)
+        {
+            idl::host::introspection::DaemonTiming& d = res.daemons.emplace_back();
+            d.name = dm._name;
+            d.created = sinceRun(dm._created);
+            d.named = sinceRun(dm._named);
+            d.started = sinceRun(dm._started);
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    idl::host::introspection::Fibers Introspection::fibers() const
+    {
+        const FiberStats& fs = _manager->_fiberStats;
+        const LoopStats& ls = _manager->_loopStats;
+
+        idl::host::introspection::Fibers res;
+        res.idle = fs._null;
+        res.ready = fs._ready;
+        res.work = fs._work;
+        res.hold = fs._hold;
+        res.total = fs._total;
+        res.peakTotal = fs._peakTotal;
+        res.samples = fs._samples;
+        res.batches = fs._batches;
+        res.readyDepth = cnvt(fs._readyDepth);
+        res.holdDepth = cnvt(fs._holdDepth);
+
+        res.loopStats = ls._enabled;
+        res.wakeupLag = cnvt(ls._wakeupLag);
+        res.batchDuration = cnvt(ls._batchDuration);
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    idl::host::introspection::Memory Introspection::memory() const
+    {
+        idl::host::introspection::Memory res;
+        res.vmSize = 0;
+        res.rss = 0;
+
+#ifndef _WIN32
+        //размеры в страницах: всего, резидентно
+        if(std::ifstream statm{"/proc/self/statm"})
+        {
+            uint64 size {}, resident {};
+            if(statm >> size >> resident)
+            {
+                uint64 page = static_cast<uint64>(sysconf(_SC_PAGESIZE));
+                res.vmSize = size * page;
+                res.rss = resident * page;
+            }
+        }
+#endif
+
+        for(const ModulePtr& module : _manager->_modules)
+        {
+            const module::Arena* arena = module->arena();
+            if(!arena)
+            {
+                continue;
+            }
+
+            const module::Arena::Stats& stats = arena->stats();
+
+            idl::host::introspection::Arena& a = res.arenas.emplace_back();
+            a.module = module->manifest()._name;
+            a.reserved = stats._reserved;
+            a.touched = stats._touched;
+            a.used = stats._used;
+            a.peak = stats._peak;
+            a.fallbacks = stats._fallbacks;
+        }
+
+        return res;
+    }
+}
@@ -0,0 +1,45 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <dci/host/module/serviceBase.hpp>
+#include <dci/cmt.hpp>
+#include <chrono>
+#include "idl-host.hpp"
+
+namespace dci::host::impl
+{
+    class Manager;
+
+    //сервис host::Introspection, создается самим Manager без модуля-поставщика
+    class Introspection
+        : public idl::gen::host::Introspection<>::Opposite
+        , public module::ServiceBase<Introspection>
+    {
+        Introspection(const Introspection&) = delete;
+        void operator=(const Introspection&) = delete;
+
+    public:
+        Introspection(Manager* manager);
+        ~Introspection();
+
+    private:
+        uint64 sinceRun(std::chrono::steady_clock::time_point moment) const;
+
+        List<idl::host::introspection::Module> modules() const;
+        List<idl::host::introspection::Service> services() const;
+        List<idl::host::introspection::Daemon> daemons() const;
+        idl::host::introspection::Timings timings() const;
+        idl::host::introspection::Fibers fibers() const;
+        idl::host::introspection::Memory memory() const;
+
+    private:
+        Manager *           _manager;
+        cmt::task::Owner    _tol;
+    };
+}
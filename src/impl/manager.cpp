@@ -10,7 +10,10 @@
 #include <dci/logger.hpp>
 #include <dci/host/exception.hpp>
 #include <dci/host/manager.hpp>
+#include <dci/host/handoff.hpp>
 #include <dci/poll.hpp>
+#include <dci/poll/awaker.hpp>
+#include <dci/poll/timer.hpp>
 #include <dci/exception.hpp>
 #include <dci/idl/contract/lidRegistry.hpp>
 #include <dci/config.hpp>
@@ -18,9 +21,18 @@
 #include <dci/utils/atScopeExit.hpp>
 #include <dci/utils/fnmatch.hpp>
 #include "../dll.hpp"
+#include "../parallel.hpp"
+#include "../placement.hpp"
+#include "introspection.hpp"
+#include "metricsDaemon.hpp"
+#include "manifestIndex.hpp"
 #include "idl-host.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -51,6 +63,12 @@ namespace
 
         return str.size() - suffix.size() == str.find(suffix);
     }
+
+    //собственные сервисы хоста, без модуля-поставщика
+    bool hostOwned(dci::idl::ILid ilid)
+    {
+        return dci::idl::gen::host::Introspection<>::lid() == ilid;
+    }
 }
 
 namespace dci::host::impl
@@ -110,6 +128,86 @@ namespace dci::host::impl
         return Module::manifest(mainBinaryFullPath);
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::verifyModules()
+    {
+        fs::path modulesDir = fs::current_path() / "../module";
+
+        std::error_code ec;
+        std::vector<fs::path> manifestPaths;
+        for(const fs::directory_entry& de : fs::directory_iterator(modulesDir, ec))
+        {
+            if(".manifest" == de.path().extension())
+            {
+                manifestPaths.emplace_back(de.path());
+            }
+        }
+
+        if(ec)
+        {
+            LOGE("verify modules: "<<modulesDir<<": "<<ec.message());
+            return false;
+        }
+
+        std::sort(manifestPaths.begin(), manifestPaths.end());
+
+        //индекс записан текущим хостом при старте, совпадение отметок - модуль обновлением не затронут
+        ManifestIndex index{modulesDir / ".index"};
+        index.load();
+
+        std::size_t amount {}, fails {};
+        for(const fs::path& manifestPath : manifestPaths)
+        {
+            ManifestIndex::Stamp stamp = ManifestIndex::stamp(manifestPath, ec);
+
+            module::Manifest cached;
+            ManifestIndex::Stamp cachedBinaryStamp;
+            if(!ec && index.find(manifestPath.filename().string(), stamp, cached, cachedBinaryStamp))
+            {
+                ManifestIndex::Stamp binaryStamp = ManifestIndex::stamp(modulesDir / cached._mainBinary, ec);
+                if(!ec && binaryStamp == cachedBinaryStamp)
+                {
+                    continue;
+                }
+            }
+
+            ++amount;
+
+            module::Manifest manifest;
+            if(!manifest.fromConfFile(manifestPath.string()))
+            {
+                LOGE("verify modules: "<<manifestPath<<": malformed manifest");
+                ++fails;
+                continue;
+            }
+
+            const std::string mainBinary = (modulesDir / manifest._mainBinary).string();
+
+            //page cache общий, прогрев здесь пригодится новому процессу
+            dllPrefetch(mainBinary);
+
+            try
+            {
+                boost::dll::shared_library sl{mainBinary, boost::dll::load_mode::rtld_now | boost::dll::load_mode::rtld_local};
+                const module::Manifest& binaryManifest = sl.get<module::Entry*>("dciModuleEntry")->manifest();
+
+                if(!binaryManifest._valid || binaryManifest.toConf() != manifest.toConf())
+                {
+                    LOGE("verify modules: "<<mainBinary<<": manifest mismatch");
+                    ++fails;
+                }
+            }
+            catch(...)
+            {
+                LOGE("verify modules: "<<mainBinary<<": "<<dci::exception::currentToString());
+                ++fails;
+            }
+        }
+
+        LOGI("verify modules: "<<amount-fails<<" of "<<amount<<" changed ok, "<<manifestPaths.size()-amount<<" unchanged");
+        return !fails;
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     Manager::Manager()
     {
@@ -118,6 +216,12 @@ namespace dci::host::impl
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     Manager::~Manager()
     {
+        //после preload без run модули остаются присоединенными
+        for(const ModulePtr& module : _modules)
+        {
+            module->detach();
+        }
+
         dbgAssert(_workersOwner.empty());
     }
 
@@ -152,19 +256,78 @@ namespace dci::host::impl
         }
 
         _workState = WorkState::starting;
+        _runMoment = std::chrono::steady_clock::now();
+
+        //до создания любых потоков, они наследуют привязку
+        applyPlacement();
+
+        {
+            std::lock_guard l{_hopsMtx};
+            _hopsAwaker = std::make_unique<poll::Awaker>(false);
+            _hopsAwaker->woken() += _hopsSol * [this]
+            {
+                std::vector<std::function<void()>> hops;
+                {
+                    std::lock_guard l{_hopsMtx};
+                    hops.swap(_hops);
+                }
+
+                for(std::function<void()>& hop : hops)
+                {
+                    cmt::spawn() += _workersOwner * std::move(hop);
+                }
+            };
+        }
+
+        //пул живет все время работы, им же пользуется загрузка модулей
+        _offload.start(_offloadThreads);
 
         if(!initializeModules())
         {
             throw exception::RunFail("modules initialization failed");
         }
 
+        _modulesInitializedMoment = std::chrono::steady_clock::now();
         _workState = WorkState::started;
 
         {
+            if(_fiberStatsInterval.count() > 0)
+            {
+                //таймер только будит цикл, обход делается перед очередным executeReadyFibers
+                _fiberStatsTimer = std::make_unique<poll::Timer>(_fiberStatsInterval, true);
+                _fiberStatsTimer->tick() += _fiberStatsSol * [this]
+                {
+                    _fiberStatsDue = true;
+                };
+                _fiberStatsTimer->start();
+            }
+
+            _watchdog.start();
+
+#ifdef DCI_HOST_LOOP_STATS
+            startLagProbe();
+#endif
+
             sbs::Owner workPossibleOwner;
             poll::workPossible() += workPossibleOwner * [&]
             {
+                _watchdog.beat();
+
+                if(_fiberStatsDue)
+                {
+                    _fiberStatsDue = false;
+                    sampleFibers();
+                }
+
+#ifdef DCI_HOST_LOOP_STATS
+                auto batchStart = std::chrono::steady_clock::now();
+#endif
                 cmt::executeReadyFibers();
+                ++_fiberStats._batches;
+
+#ifdef DCI_HOST_LOOP_STATS
+                _loopStats._batchDuration.add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - batchStart).count()));
+#endif
             };
 
             if(std::error_code ec = poll::run())
@@ -179,6 +342,63 @@ namespace dci::host::impl
             }
         }
 
+        _watchdog.stop();
+
+        if(_lagProbe)
+        {
+            _lagProbe->stop();
+            _lagProbeSol.flush();
+            _lagProbe.reset();
+        }
+
+        if(_fiberStatsTimer)
+        {
+            _fiberStatsTimer->stop();
+            _fiberStatsSol.flush();
+            _fiberStatsTimer.reset();
+        }
+
+        LOGI("fibers: peak "<<_fiberStats._peakTotal<<", batches "<<_fiberStats._batches);
+
+        if(_loopStats._enabled)
+        {
+            auto line = [](const char* name, const Histogram& h)
+            {
+                Histogram::Summary s = h.summary();
+                LOGI("loop "<<name<<": "<<s._count<<" samples, p50 "<<s._p50<<"ns, p99 "<<s._p99<<"ns, p999 "<<s._p999<<"ns, max "<<s._max<<"ns");
+            };
+            line("wakeup lag", _loopStats._wakeupLag);
+            line("batch duration", _loopStats._batchDuration);
+        }
+
+        //принятые post задачи выполняются, а не теряются; дальше post отказывает
+        {
+            std::vector<std::function<void()>> hops;
+            {
+                std::lock_guard l{_hopsMtx};
+                hops.swap(_hops);
+                _hopsSol.flush();
+                _hopsAwaker.reset();
+            }
+
+            if(!hops.empty())
+            {
+                LOGI("running "<<hops.size()<<" hops posted before stop");
+
+                cmt::task::Owner hopsOwner;
+                for(std::function<void()>& hop : hops)
+                {
+                    cmt::spawn() += hopsOwner * std::move(hop);
+                }
+                cmt::executeReadyFibers();
+
+                //ожидающие чего-либо после остановки цикла уже не дождутся
+                hopsOwner.stop();
+            }
+        }
+
+        _offload.stop();
+
         {
             std::error_code ec = poll::deinitialize();
             if(ec)
@@ -211,13 +431,14 @@ namespace dci::host::impl
         {
             {
                 Daemons daemons{std::move(_daemons)};
+                notifyChanged(Change::daemons);
                 std::vector<cmt::Future<None>> stops;
                 stops.reserve(daemons.size());
                 for(auto& daemon : daemons)
                 {
-                    if(daemon.second)
+                    if(daemon.second._daemon)
                     {
-                        stops.emplace_back(daemon.second->stop());
+                        stops.emplace_back(daemon.second._daemon->stop());
                     }
                 }
 
@@ -227,6 +448,19 @@ namespace dci::host::impl
                 }
             }
 
+            //мягкая фаза: модули дорабатывают то, что держат StopLocker, но не дольше общего срока
+            {
+                std::vector<Module*> started;
+                for(const ModulePtr& module : _modules)
+                {
+                    if(Module::State::started == module->state() || Module::State::startError == module->state())
+                    {
+                        started.push_back(module.get());
+                    }
+                }
+                drainModules(started);
+            }
+
             if(!deinitializeModules())
             {
                 LOGE("modules deinitialization failed");
@@ -247,215 +481,1074 @@ namespace dci::host::impl
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    bool Manager::startModules(std::set<std::string>&& byNames, std::set<std::string>&& byServices)
+    void Manager::loadThreads(std::size_t amount)
     {
-        std::vector<Module*> selected;
+        _loadThreads = amount;
+    }
 
-        const auto match = [](const std::set<std::string>& patterns, const std::string& value)
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::offloadThreads(std::size_t amount)
+    {
+        _offloadThreads = amount;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::drainTimeout(std::chrono::milliseconds timeout)
+    {
+        _drainTimeout = timeout;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::restartDowntime(std::chrono::microseconds downtime)
+    {
+        _restartDowntime = downtime;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::watchdog(std::chrono::milliseconds stall, std::chrono::milliseconds abort)
+    {
+        _watchdog.thresholds(stall, abort);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::fiberStatsInterval(std::chrono::milliseconds interval)
+    {
+        _fiberStatsInterval = interval;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const FiberStats& Manager::fiberStats()
+    {
+        return _fiberStats;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    sbs::Signal<void, Manager::Change> Manager::changed()
+    {
+        return _changed.out();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    sbs::Signal<> Manager::binariesChanged()
+    {
+        return _binariesChanged.out();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::notifyChanged(Change what)
+    {
+        if(Change::services != what && _watchdog.enabled())
         {
-            for(const std::string& pattern : patterns)
-            {
-                if(!pattern.empty() && !value.empty() && utils::fnmatch(pattern.c_str(), value.c_str()))
-                {
-                    return true;
-                }
-            }
+            updateWatchdogBinaries();
+        }
 
-            return false;
-        };
+        _changed.in(what);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::updateWatchdogBinaries()
+    {
+        std::vector<Watchdog::Binary> binaries;
+        binaries.reserve(_modules.size());
 
         for(const ModulePtr& module : _modules)
         {
-            const module::Manifest& manifest = module->manifest();
-
-            if(match(byNames, manifest._name))
+            std::error_code ec;
+            fs::path path = fs::weakly_canonical(module->manifestFile().parent_path() / module->manifest()._mainBinary, ec);
+            if(ec)
             {
-                selected.emplace_back(module.get());
                 continue;
             }
 
-            for(const module::Manifest::ServiceId& serviceId : manifest._serviceIds)
+            Watchdog::Binary& binary = binaries.emplace_back();
+            binary._path = path.string();
+            binary._module = module->manifest()._name;
+
+            //одноименные экземпляры идут в multimap подряд, имя пишется один раз
+            const std::string* last {};
+            for(const auto& [name, instance] : _daemons)
             {
-                if(byServices.contains(serviceId._iid.toText()) || match(byServices, serviceId._alias))
+                if(module.get() == instance._module && (!last || *last != name))
                 {
-                    selected.emplace_back(module.get());
-                    break;
+                    binary._daemons += (binary._daemons.empty() ? "" : ", ") + name;
+                    last = &name;
                 }
             }
         }
 
-        return massModulesOperation(selected, "startModule", [](Module* m)
-        {
-            return m->start();
-        });
+        _watchdog.binaries(std::move(binaries));
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    cmt::Future<int> Manager::runTest(const std::vector<std::string>& argv, TestStage stage)
+    const LoopStats& Manager::loopStats()
     {
-        return cmt::spawnv() += _workersOwner * [=,this]()
-        {
-            return executeTest(argv, stage, himpl::impl2Face<host::Manager>(this));
-        };
+        return _loopStats;
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    cmt::Future<> Manager::runDaemon(const std::vector<std::string>& argv)
+    //пробный таймер: от момента, когда он должен сработать, до исполнения порожденного им волокна
+    void Manager::startLagProbe()
     {
-        if(argv.empty())
-        {
-            return cmt::readyFuture<void>(std::make_exception_ptr(exception::DaemonRunFail("empty argv")));
-        }
-
-        std::string moduleName;
-        std::string::size_type dotPos = argv[0].find('.');
-        if(std::string::npos == dotPos)
-        {
-            moduleName = argv[0];
-        }
-        else
-        {
-            moduleName = argv[0].substr(0, dotPos);
-        }
+        constexpr std::chrono::milliseconds interval{10};
 
-        auto iter = _modulesByName.find(moduleName);
-        if(_modulesByName.end() == iter)
+        _loopStats._enabled = true;
+        _lagProbe = std::make_unique<poll::Timer>(interval, true);
+        _lagProbe->tick() += _lagProbeSol * [this, interval]
         {
-            return cmt::readyFuture<void>(std::make_exception_ptr(exception::DaemonRunFail("module \""+moduleName+"\" not found")));
-        }
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            const std::chrono::steady_clock::time_point due = _lagProbeDue;
 
-        Module* module = iter->second;
-        cmt::Future<idl::Interface> fd = module->createService(dci::idl::gen::host::Daemon<>::lid());
+            //пропущенные за долгую задержку срабатывания таймер не нагоняет: этот замер честно содержит задержку,
+            //а следующий срок отсчитывается от текущего момента, иначе отставание копилось бы во всех последующих
+            _lagProbeDue = now - due > interval ? now + interval : due + interval;
 
-        return cmt::spawnv() += _workersOwner * [fd=std::move(fd), argv=std::move(argv), this]()
-        {
-            try
+            cmt::spawn() += _workersOwner * [this, due]
             {
-                dci::idl::gen::host::Daemon<> dmn = fd.value();
-
-                if(!dmn)
-                {
-                    throw exception::DaemonRunFail("module \""+argv[0]+"\" provides null daemon instance");
-                }
+                auto lag = std::chrono::steady_clock::now() - due;
+                _loopStats._wakeupLag.add(static_cast<std::uint64_t>(std::max(std::chrono::nanoseconds{}, std::chrono::duration_cast<std::chrono::nanoseconds>(lag)).count()));
+            };
+        };
 
-                _daemons.emplace(std::make_pair(argv[0], dmn));
+        _lagProbeDue = std::chrono::steady_clock::now() + interval;
+        _lagProbe->start();
+    }
 
-                idl::Config cfg = config::cnvt(config::parse(std::vector<std::string>{argv.begin()+1, argv.end()}));
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    //вне волокон: enumerateFibers переключается в каждое волокно, включая текущее
+    void Manager::sampleFibers()
+    {
+        struct Counts
+        {
+            std::size_t _null {};
+            std::size_t _ready {};
+            std::size_t _work {};
+            std::size_t _hold {};
+        } counts;
 
-                dmn->setName(argv[0]).value();
-                dmn->start(std::move(cfg)).value();
-            }
-            catch(...)
+        cmt::enumerateFibers([](cmt::task::State state, void* data)
+        {
+            Counts& counts = *static_cast<Counts*>(data);
+            switch(state)
             {
-                std::rethrow_exception(
-                    dci::exception::buildInstance<exception::DaemonRunFail>(
-                                std::current_exception())
-                );
+            case cmt::task::State::null : ++counts._null ; break;
+            case cmt::task::State::ready: ++counts._ready; break;
+            case cmt::task::State::work : ++counts._work ; break;
+            case cmt::task::State::hold : ++counts._hold ; break;
+            default: break;
             }
-        };
+        }, &counts);
+
+        FiberStats& fs = _fiberStats;
+        fs._null = counts._null;
+        fs._ready = counts._ready;
+        fs._work = counts._work;
+        fs._hold = counts._hold;
+        fs._total = counts._null + counts._ready + counts._work + counts._hold;
+        fs._peakTotal = std::max(fs._peakTotal, fs._total);
+
+        ++fs._samples;
+        fs._readyDepth.add(counts._ready);
+        fs._holdDepth.add(counts._hold);
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    cmt::Future<> Manager::runDaemons(const std::vector<std::string>& argv)
+    bool Manager::placement(const std::string& loopCpus, const std::string& helperCpus, int numaNode)
     {
-        if(argv.size() < 2)
+        if(!parseCpuList(loopCpus, _loopCpus))
         {
-            return cmt::readyFuture<void>(std::make_exception_ptr(exception::DaemonRunFail("bad argv")));
+            LOGE("placement: bad cpu list \""<<loopCpus<<"\", cpus 0-"<<cpusLimit()-1<<" are available");
+            return false;
         }
 
-        std::size_t amount {};
-        try
-        {
-            amount = static_cast<std::size_t>(std::stoul(argv[0]));
-        }
-        catch(...)
+        if(!parseCpuList(helperCpus, _helperCpus))
         {
-            return cmt::readyFuture<void>(dci::exception::buildInstance<exception::DaemonRunFail>(std::current_exception(), "bad argv"));
+            LOGE("placement: bad cpu list \""<<helperCpus<<"\", cpus 0-"<<cpusLimit()-1<<" are available");
+            return false;
         }
 
-        std::vector<std::string> oneArgv{++argv.begin(), argv.end()};
+        _numaNode = numaNode;
+        _offload.cpus(_helperCpus);
+        return true;
+    }
 
-        return cmt::spawnv() += _workersOwner * [amount, oneArgv=std::move(oneArgv), this]()
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::applyPlacement()
+    {
+        std::string error;
+        _placementApplied.clear();
+
+        if(!_loopCpus.empty())
         {
-            std::vector<cmt::Future<>> res;
-            for(std::size_t i{0}; i<amount; ++i)
+            if(pinCurrentThread(_loopCpus, error))
             {
-                res.push_back(runDaemon(oneArgv));
+                _placementApplied += "loop cpus "+cpuListText(_loopCpus);
             }
-
-            for(cmt::Future<>& f : res)
+            else
             {
-                f.wait();
-
-                if(f.resolvedException())
-                {
-                    std::rethrow_exception(f.detachException());
-                }
+                LOGW("placement: loop thread: "<<error);
             }
-        };
-    }
-
-    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    cmt::Future<idl::Interface> Manager::createService(idl::ILid ilid)
-    {
-        const auto iter = _serviceProviders.find(ilid);
+        }
 
-        if(_serviceProviders.end() == iter)
+        if(!_helperCpus.empty())
         {
-            std::string descr = "iid not registred: "+ilid.toIidText();
-            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService(std::move(descr))));
+            _placementApplied += (_placementApplied.empty() ? "" : ", ") + std::string{"helper cpus "} + cpuListText(_helperCpus);
         }
 
-        Module* module = iter->second;
+        if(0 <= _numaNode)
+        {
+            if(bindMemoryToNode(_numaNode, error))
+            {
+                _placementApplied += (_placementApplied.empty() ? "" : ", ") + std::string{"memory node "} + std::to_string(_numaNode);
+            }
+            else
+            {
+                LOGW("placement: numa node "<<_numaNode<<": "<<error);
+            }
+        }
+
+        if(!_placementApplied.empty())
+        {
+            LOGI("placement: "<<_placementApplied);
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Offload& Manager::offload()
+    {
+        return _offload;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::post(std::function<void()>&& f)
+    {
+        std::lock_guard l{_hopsMtx};
+        if(!_hopsAwaker)
+        {
+            return false;
+        }
+
+        _hops.emplace_back(std::move(f));
+        _hopsAwaker->wakeup();
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<> Manager::runOffloaded(std::function<void()>&& job)
+    {
+        if(!_offload.started())
+        {
+            try
+            {
+                job();
+            }
+            catch(...)
+            {
+                return cmt::readyFuture<void>(std::current_exception());
+            }
+
+            return cmt::readyFuture();
+        }
+
+        return _offload.run(std::move(job));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::startModules(std::set<std::string>&& byNames, std::set<std::string>&& byServices)
+    {
+        std::vector<Module*> selected;
+
+        const auto match = [](const std::set<std::string>& patterns, const std::string& value)
+        {
+            for(const std::string& pattern : patterns)
+            {
+                if(!pattern.empty() && !value.empty() && utils::fnmatch(pattern.c_str(), value.c_str()))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        for(const ModulePtr& module : _modules)
+        {
+            const module::Manifest& manifest = module->manifest();
+
+            if(match(byNames, manifest._name))
+            {
+                selected.emplace_back(module.get());
+                continue;
+            }
+
+            for(const module::Manifest::ServiceId& serviceId : manifest._serviceIds)
+            {
+                if(byServices.contains(serviceId._iid.toText()) || match(byServices, serviceId._alias))
+                {
+                    selected.emplace_back(module.get());
+                    break;
+                }
+            }
+        }
+
+        //все проблемы зависимостей выявляются до загрузки первого модуля
+        std::vector<std::vector<Module*>> levels;
+        if(!buildStartLevels(selected, levels))
+        {
+            return false;
+        }
+
+        std::size_t amount {};
+        for(const std::vector<Module*>& level : levels)
+        {
+            amount += level.size();
+        }
+
+        const auto startMoment = std::chrono::steady_clock::now();
+
+        //чтение бинарников модулей уходит в пул потоков, dlopen и Entry::load/start остаются в потоке цикла
+        const bool ownOffload = !_offload.started();
+        if(ownOffload)
+        {
+            _offload.start(std::min(_loadThreads, amount));
+        }
+        utils::AtScopeExit offloadStopper{[&]
+        {
+            if(ownOffload)
+            {
+                _offload.stop();
+            }
+        }};
+
+        bool res = true;
+        for(std::size_t i{}; i<levels.size(); ++i)
+        {
+            if(!massModulesOperation(levels[i], "startModule", [](Module* m)
+            {
+                return m->start();
+            }))
+            {
+                if(i+1 < levels.size())
+                {
+                    LOGE("start modules: level "<<i<<" failed, dependent levels skipped");
+                }
+                res = false;
+                break;
+            }
+        }
+
+        LOGI("start modules: "<<amount<<" in "<<levels.size()<<" levels, "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startMoment).count()<<"us, "
+             <<(_offload.started() ? "parallel" : "serial")<<" load");
+
+        notifyChanged(Change::modules);
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<int> Manager::runTest(const std::vector<std::string>& argv, TestStage stage)
+    {
+        return cmt::spawnv() += _workersOwner * [=,this]()
+        {
+            return executeTest(argv, stage, himpl::impl2Face<host::Manager>(this));
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<> Manager::runDaemon(const std::vector<std::string>& argv)
+    {
+        if(argv.empty())
+        {
+            return cmt::readyFuture<void>(std::make_exception_ptr(exception::DaemonRunFail("empty argv")));
+        }
+
+        Module* module {};
+
+        //встроенные демоны хоста, без модуля
+        const bool builtin = MetricsDaemon::_builtinName == argv[0];
+
+        if(!builtin)
+        {
+            std::string moduleName;
+            std::string::size_type dotPos = argv[0].find('.');
+            if(std::string::npos == dotPos)
+            {
+                moduleName = argv[0];
+            }
+            else
+            {
+                moduleName = argv[0].substr(0, dotPos);
+            }
+
+            auto iter = _modulesByName.find(moduleName);
+            if(_modulesByName.end() == iter)
+            {
+                return cmt::readyFuture<void>(std::make_exception_ptr(exception::DaemonRunFail("module \""+moduleName+"\" not found")));
+            }
+
+            module = iter->second;
+        }
+
+        const std::size_t momentsIndex = _daemonMoments.size();
+        _daemonMoments.emplace_back()._name = argv[0];
+        _daemonMoments.back()._creating = std::chrono::steady_clock::now();
+
+        cmt::Future<idl::Interface> fd = builtin ?
+                    cmt::readyFuture(MetricsDaemon::create(this)) :
+                    module->createService(dci::idl::gen::host::Daemon<>::lid());
+
+        return cmt::spawnv() += _workersOwner * [fd=std::move(fd), argv=std::move(argv), module, momentsIndex, this]()
+        {
+            try
+            {
+                dci::idl::gen::host::Daemon<> dmn = fd.value();
+                _daemonMoments[momentsIndex]._created = std::chrono::steady_clock::now();
+
+                if(!dmn)
+                {
+                    throw exception::DaemonRunFail("module \""+argv[0]+"\" provides null daemon instance");
+                }
+
+                _daemons.emplace(argv[0], DaemonInstance{dmn, module, argv});
+                notifyChanged(Change::daemons);
+
+                idl::Config cfg = config::cnvt(config::parse(std::vector<std::string>{argv.begin()+1, argv.end()}));
+
+                //демон забирает их через handoff::take до собственного bind
+                if(std::vector<std::string> handed = handoff::pending(argv[0]); !handed.empty())
+                {
+                    std::string names;
+                    for(const std::string& name : handed)
+                    {
+                        names += (names.empty() ? "" : ", ") + name;
+                    }
+                    LOGI("daemon "<<argv[0]<<": handed over from previous process: "<<names);
+                }
+
+                dmn->setName(argv[0]).value();
+                _daemonMoments[momentsIndex]._named = std::chrono::steady_clock::now();
+
+                dmn->start(std::move(cfg)).value();
+                _daemonMoments[momentsIndex]._started = std::chrono::steady_clock::now();
+                notifyChanged(Change::daemons);
+            }
+            catch(...)
+            {
+                std::rethrow_exception(
+                    dci::exception::buildInstance<exception::DaemonRunFail>(
+                                std::current_exception())
+                );
+            }
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<> Manager::runDaemons(const std::vector<std::string>& argv)
+    {
+        if(argv.size() < 2)
+        {
+            return cmt::readyFuture<void>(std::make_exception_ptr(exception::DaemonRunFail("bad argv")));
+        }
+
+        std::size_t amount {};
+        try
+        {
+            amount = static_cast<std::size_t>(std::stoul(argv[0]));
+        }
+        catch(...)
+        {
+            return cmt::readyFuture<void>(dci::exception::buildInstance<exception::DaemonRunFail>(std::current_exception(), "bad argv"));
+        }
+
+        std::vector<std::string> oneArgv{++argv.begin(), argv.end()};
+
+        return cmt::spawnv() += _workersOwner * [amount, oneArgv=std::move(oneArgv), this]()
+        {
+            std::vector<cmt::Future<>> res;
+            for(std::size_t i{0}; i<amount; ++i)
+            {
+                res.push_back(runDaemon(oneArgv));
+            }
+
+            for(cmt::Future<>& f : res)
+            {
+                f.wait();
+
+                if(f.resolvedException())
+                {
+                    std::rethrow_exception(f.detachException());
+                }
+            }
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<> Manager::reloadModule(const std::string& name)
+    {
+        if(WorkState::started != _workState)
+        {
+            return cmt::readyFuture<void>(std::make_exception_ptr(exception::RunFail("reload module \""+name+"\": manager is not started")));
+        }
+
+        auto iter = _modulesByName.find(name);
+        if(_modulesByName.end() == iter)
+        {
+            return cmt::readyFuture<void>(std::make_exception_ptr(exception::RunFail("reload module \""+name+"\": not found")));
+        }
+
+        Module* module = iter->second;
+        ModulePtr keep;
+        for(const ModulePtr& m : _modules)
+        {
+            if(module == m.get())
+            {
+                keep = m;
+                break;
+            }
+        }
+
+        return cmt::spawnv() += _workersOwner * [module, keep=std::move(keep), name, this]()
+        {
+            const auto startMoment = std::chrono::steady_clock::now();
+            const bool wasStarted = Module::State::started == module->state();
+
+            //демоны модуля останавливаются и запоминаются для перезапуска, остальные продолжают работу
+            std::vector<std::vector<std::string>> daemonArgvs;
+            {
+                std::vector<cmt::Future<None>> stops;
+                for(auto daemonIter = _daemons.begin(); daemonIter != _daemons.end();)
+                {
+                    if(module != daemonIter->second._module)
+                    {
+                        ++daemonIter;
+                        continue;
+                    }
+
+                    daemonArgvs.emplace_back(std::move(daemonIter->second._argv));
+                    if(daemonIter->second._daemon)
+                    {
+                        stops.emplace_back(daemonIter->second._daemon->stop());
+                    }
+                    daemonIter = _daemons.erase(daemonIter);
+                }
+                notifyChanged(Change::daemons);
+
+                for(const cmt::Future<None>& stop : stops)
+                {
+                    stop.wait();
+                }
+            }
+
+            auto rerunDaemons = [&]
+            {
+                std::vector<cmt::Future<>> runs;
+                for(const std::vector<std::string>& argv : daemonArgvs)
+                {
+                    runs.emplace_back(runDaemon(argv));
+                }
+
+                std::size_t failedDaemons {};
+                for(cmt::Future<>& run : runs)
+                {
+                    if(run.waitException())
+                    {
+                        LOGE("reload module \""<<name<<"\": "<<dci::exception::toString(run.detachException()));
+                        ++failedDaemons;
+                    }
+                }
+
+                return failedDaemons;
+            };
+
+            //dlclose допустим только когда кодом модуля никто не пользуется, иначе отмена и работа со старым бинарником
+            if(wasStarted)
+            {
+                drainModules({module});
+
+                if(std::size_t locks = module->stopLocks())
+                {
+                    module->cancelStopRequest();
+                    rerunDaemons();
+                    throw exception::RunFail("reload module \""+name+"\": "+std::to_string(locks)+" stop locks held after drain, reload aborted, previous binary kept");
+                }
+
+                module->stop();
+                notifyChanged(Change::modules);
+            }
+
+            //живые объекты сервисов в арене, кроме лежащих в пулах самого модуля; созданные через tryCreateHeapService здесь не видны
+            if(const module::Arena* arena = module->arena(); arena && arena->live() > arena->pooled())
+            {
+                const std::size_t alive = arena->live() - arena->pooled();
+
+                const bool restarted = !wasStarted || module->start();
+                notifyChanged(Change::modules);
+                if(restarted)
+                {
+                    rerunDaemons();
+                }
+
+                throw exception::RunFail("reload module \""+name+"\": "+std::to_string(alive)+" service objects alive, reload aborted, previous binary kept");
+            }
+
+            const std::string mainBinary = (module->manifestFile().parent_path() / module->manifest()._mainBinary).string();
+
+            //от detach до повторной регистрации нет точек переключения волокон, другие волокна видят реестр либо старым, либо новым
+            if(!module->detach())
+            {
+                throw exception::RunFail("reload module \""+name+"\": unable to detach");
+            }
+
+            _services.removeModule(module);
+            std::erase_if(_modulesByName, [module](const auto& v)
+            {
+                return module == v.second;
+            });
+
+            dllUnload(mainBinary);
+
+            //набор загруженных объектов изменился, в том числе при неудаче ниже
+            utils::AtScopeExit binariesChanged{[this]
+            {
+                _binariesChanged.in();
+            }};
+
+            if(!module->attach())
+            {
+                //модуль выводится из состава целиком, чтобы остановка и интроспекция его больше не видели
+                std::erase_if(_modules, [module](const ModulePtr& m)
+                {
+                    return module == m.get();
+                });
+
+                _services.freeze();
+                notifyChanged(Change::services);
+                notifyChanged(Change::modules);
+                throw exception::RunFail("reload module \""+name+"\": unable to attach, module removed");
+            }
+
+            registerModule(module);
+            _services.freeze();
+            notifyChanged(Change::services);
+
+            bool started = !wasStarted || module->start();
+            notifyChanged(Change::modules);
+            if(!started)
+            {
+                throw exception::RunFail("reload module \""+name+"\": unable to start");
+            }
+
+            std::size_t failedDaemons = rerunDaemons();
+
+            LOGI("reload module \""<<name<<"\": done in "
+                 <<std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startMoment).count()<<"us, "
+                 <<daemonArgvs.size()-failedDaemons<<" of "<<daemonArgvs.size()<<" daemons restarted");
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<idl::Interface> Manager::createService(idl::ILid ilid)
+    {
+        if(hostOwned(ilid))
+        {
+            Introspection* srv = new Introspection{this};
+            srv->involvedChanged() += srv->sol() * [srv](bool v)
+            {
+                if(!v)
+                {
+                    delete srv;
+                }
+            };
+
+            return cmt::readyFuture(idl::Interface(srv->opposite()));
+        }
+
+        ++_serviceStats._calls;
+
+        Module* module = _services.provider(ilid);
+
+        if(!module)
+        {
+            ++_serviceStats._failures;
+            std::string descr = "iid not registred: "+ilid.toIidText();
+            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService(std::move(descr))));
+        }
+
+        const auto startMoment = std::chrono::steady_clock::now();
+        cmt::Future<idl::Interface> res = module->createService(ilid);
+        res.then() += [this, startMoment](auto in)
+        {
+            if(in.resolvedException() || in.resolvedCancel())
+            {
+                ++_serviceStats._failures;
+            }
+            _serviceStats._latency.add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startMoment).count()));
+        };
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<idl::Interface> Manager::createService(std::string_view alias)
+    {
+        idl::ILid ilid;
+        if(_services.resolve(alias, ilid))
+        {
+            if(!ilid)
+            {
+                std::string descr = "iid not registred: "+std::string{alias};
+                return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService(std::move(descr))));
+            }
+            return createService(ilid);
+        }
+
+        std::string descr = "alias not registred: "+std::string{alias};
+        return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService(std::move(descr))));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<std::vector<cmt::Future<idl::Interface>>> Manager::createServices(const std::vector<host::Manager::ServiceRequest>& requests)
+    {
+        using Results = std::vector<cmt::Future<idl::Interface>>;
+
+        struct Item
+        {
+            Module*                         _module {};
+            idl::ILid                       _ilid {};
+            std::size_t                     _index {};
+            bool                            _hostOwned = false;
+            std::exception_ptr              _fail;
+        };
+
+        std::vector<Item> items;
+        items.reserve(requests.size());
+
+        for(std::size_t index{}; index < requests.size(); ++index)
+        {
+            Item& item = items.emplace_back();
+            item._index = index;
+
+            const host::Manager::ServiceRequest& request = requests[index];
+            if(const idl::IId* iid = std::get_if<idl::IId>(&request))
+            {
+                item._ilid = idl::ILid{idl::contract::lidRegistry.get(iid->_cid), iid->_side};
+            }
+            else if(const idl::ILid* ilid = std::get_if<idl::ILid>(&request))
+            {
+                item._ilid = *ilid;
+            }
+            else
+            {
+                const std::string& alias = std::get<std::string>(request);
+                if(!_services.resolve(alias, item._ilid))
+                {
+                    item._fail = std::make_exception_ptr(exception::UnableToCreateService("alias not registred: "+alias));
+                    continue;
+                }
+            }
+
+            //как в одиночном createService, мимо реестра и счетчиков
+            if(hostOwned(item._ilid))
+            {
+                item._hostOwned = true;
+                continue;
+            }
+
+            item._module = item._ilid ? _services.provider(item._ilid) : nullptr;
+            if(!item._module)
+            {
+                item._fail = std::make_exception_ptr(exception::UnableToCreateService("iid not registred: "+item._ilid.toIidText()));
+            }
+        }
+
+        //задержка пакетных запросов не замеряется, только счет
+        _serviceStats._calls += static_cast<std::uint64_t>(std::count_if(items.begin(), items.end(), [](const Item& item){ return !item._hostOwned; }));
+        _serviceStats._failures += static_cast<std::uint64_t>(std::count_if(items.begin(), items.end(), [](const Item& item){ return !!item._fail; }));
+
+        //по одному обращению к каждому модулю-поставщику
+        std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b)
+        {
+            return std::less<Module*>{}(a._module, b._module);
+        });
+
+        std::vector<std::pair<std::size_t, cmt::Future<idl::Interface>>> placed;
+        placed.reserve(items.size());
+
+        std::vector<idl::ILid> ilids;
+        for(auto iter = items.begin(); iter != items.end();)
+        {
+            auto groupEnd = std::find_if(iter, items.end(), [&](const Item& item)
+            {
+                return item._module != iter->_module;
+            });
+
+            if(!iter->_module)
+            {
+                for(; iter != groupEnd; ++iter)
+                {
+                    placed.emplace_back(iter->_index, iter->_hostOwned ? createService(iter->_ilid) : cmt::readyFuture<idl::Interface>(iter->_fail));
+                }
+                continue;
+            }
+
+            ilids.clear();
+            for(auto i = iter; i != groupEnd; ++i)
+            {
+                ilids.push_back(i->_ilid);
+            }
+
+            Results groupResults = iter->_module->createServices(ilids);
+            for(cmt::Future<idl::Interface>& f : groupResults)
+            {
+                placed.emplace_back(iter->_index, std::move(f));
+                ++iter;
+            }
+        }
+
+        std::sort(placed.begin(), placed.end(), [](const auto& a, const auto& b)
+        {
+            return a.first < b.first;
+        });
+
+        Results results;
+        results.reserve(placed.size());
+        bool allResolved = true;
+        for(auto& p : placed)
+        {
+            allResolved = allResolved && p.second.resolved();
+            results.emplace_back(std::move(p.second));
+        }
+
+        if(allResolved)
+        {
+            return cmt::readyFuture<Results>(std::move(results));
+        }
+
+        //одно продолжение на весь пакет
+        return cmt::spawnv() += _workersOwner * [results=std::move(results)]() mutable
+        {
+            for(cmt::Future<idl::Interface>& f : results)
+            {
+                f.wait();
+            }
+
+            return std::move(results);
+        };
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<idl::Interface> Manager::getDaemonService(const std::string& name)
+    {
+        Daemons::iterator iter = _daemons.find(name);
+        if(_daemons.end() == iter)
+        {
+            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::DaemonGetFail("daemon \""+name+"\" not found")));
+        }
+
+        if(!iter->second._daemon)
+        {
+            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::DaemonGetFail("daemon \""+name+"\" empty")));
+        }
+
+        return iter->second._daemon->service();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::startupReport(const std::string& jsonFile)
+    {
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        //микросекунды между моментами, -1 если какой-то из них не наступал
+        auto us = [](TimePoint from, TimePoint to) -> long long
+        {
+            if(TimePoint{} == from || TimePoint{} == to)
+            {
+                return -1;
+            }
+            return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+        };
+
+        struct ModuleLine
+        {
+            const Module*   _module;
+            long long       _parse;
+            long long       _dlopen;
+            long long       _load;
+            long long       _start;
+            long long       _finish;
+        };
 
-        return module->createService(ilid);
-    }
+        std::vector<ModuleLine> lines;
+        lines.reserve(_modules.size());
+        for(const ModulePtr& module : _modules)
+        {
+            const Module::Moments& m = module->moments();
+            auto state = [&](Module::State s)
+            {
+                return m._states[static_cast<std::size_t>(s)];
+            };
 
-    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    cmt::Future<idl::Interface> Manager::createService(const std::string& alias)
-    {
-        idl::ILid ilid;
-        if(ilid.fromIidText(alias))
+            lines.push_back(ModuleLine{
+                module.get(),
+                us(m._attaching, state(Module::State::attached)),
+                us(state(Module::State::loading), m._resolved),
+                us(m._resolved, state(Module::State::loaded)),
+                us(state(Module::State::starting), state(Module::State::started)),
+                us(_runMoment, state(Module::State::started)),
+            });
+        }
+
+        //самые медленные первыми
+        std::sort(lines.begin(), lines.end(), [](const ModuleLine& a, const ModuleLine& b)
         {
-            if(!ilid)
+            return a._finish > b._finish;
+        });
+
+        //критический путь: от завершившегося последним по requires к поставщику, завершившемуся последним из его поставщиков
+        std::vector<const ModuleLine*> criticalPath;
+        if(!lines.empty() && 0 <= lines.front()._finish)
+        {
+            std::map<const Module*, const ModuleLine*> byModule;
+            for(const ModuleLine& l : lines)
             {
-                std::string descr = "iid not registred: "+alias;
-                return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService(std::move(descr))));
+                byModule.emplace(l._module, &l);
             }
-            return createService(ilid);
+
+            for(const ModuleLine* cur = &lines.front(); cur;)
+            {
+                criticalPath.push_back(cur);
+
+                const ModuleLine* next {};
+                for(const std::string& require : cur->_module->manifest()._requires)
+                {
+                    auto iter = byModule.find(requiredProvider(require));
+                    if(byModule.end() == iter || iter->second == cur || 0 > iter->second->_finish)
+                    {
+                        continue;
+                    }
+
+                    if(!next || next->_finish < iter->second->_finish)
+                    {
+                        next = iter->second;
+                    }
+                }
+
+                if(next && criticalPath.end() != std::find(criticalPath.begin(), criticalPath.end(), next))
+                {
+                    break;
+                }
+                cur = next;
+            }
+
+            std::reverse(criticalPath.begin(), criticalPath.end());
         }
 
-        const auto iter = _serviceAliases.find(alias);
+        LOGI("startup: modules initialized in "<<us(_runMoment, _modulesInitializedMoment)<<"us"
+             <<(_placementApplied.empty() ? std::string{} : ", placement: "+_placementApplied));
+        for(const ModuleLine& l : lines)
+        {
+            if(0 > l._finish)
+            {
+                continue;
+            }
+
+            LOGI("startup: module "<<l._module->manifest()._name<<" done at "<<l._finish<<"us"
+                 <<", parse "<<l._parse<<", dlopen "<<l._dlopen<<", load "<<l._load<<", start "<<l._start);
+        }
 
-        if(_serviceAliases.end() == iter)
+        if(!criticalPath.empty())
         {
-            std::string descr = "alias not registred: "+alias;
-            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService(std::move(descr))));
+            std::string path;
+            for(const ModuleLine* l : criticalPath)
+            {
+                path += (path.empty() ? "" : " -> ") + l->_module->manifest()._name + " " + std::to_string(l->_finish) + "us";
+            }
+            LOGI("startup: critical path "<<path);
         }
 
-        return createService(iter->second);
-    }
+        for(const DaemonMoments& d : _daemonMoments)
+        {
+            LOGI("startup: daemon "<<d._name<<" done at "<<us(_runMoment, d._started)<<"us"
+                 <<", create "<<us(d._creating, d._created)<<", setName "<<us(d._created, d._named)<<", start "<<us(d._named, d._started));
+        }
 
-    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-    cmt::Future<idl::Interface> Manager::getDaemonService(const std::string& name)
-    {
-        Daemons::iterator iter = _daemons.find(name);
-        if(_daemons.end() == iter)
+        if(jsonFile.empty())
         {
-            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::DaemonGetFail("daemon \""+name+"\" not found")));
+            return;
         }
 
-        if(!iter->second)
+        auto str = [](const std::string& v)
         {
-            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::DaemonGetFail("daemon \""+name+"\" empty")));
+            std::string res{"\""};
+            for(char c : v)
+            {
+                switch(c)
+                {
+                case '"':   res += "\\\""; break;
+                case '\\':  res += "\\\\"; break;
+                case '\n':  res += "\\n"; break;
+                default:
+                    if(static_cast<unsigned char>(c) < 0x20)
+                    {
+                        continue;
+                    }
+                    res += c;
+                }
+            }
+            res += '"';
+            return res;
+        };
+
+        std::ofstream out{jsonFile, std::ios::trunc};
+        if(!out)
+        {
+            LOGE("startup report: unable to write "<<jsonFile<<": "<<strerror(errno));
+            return;
         }
 
-        return iter->second->service();
+        out << "{\n  \"modulesInitialized\": " << us(_runMoment, _modulesInitializedMoment)
+            << ",\n  \"placement\": " << str(_placementApplied)
+            << ",\n  \"modules\": [";
+        const char* sep = "\n";
+        for(const ModuleLine& l : lines)
+        {
+            out << sep << "    {\"name\": " << str(l._module->manifest()._name)
+                << ", \"parse\": " << l._parse
+                << ", \"dlopen\": " << l._dlopen
+                << ", \"load\": " << l._load
+                << ", \"start\": " << l._start
+                << ", \"finish\": " << l._finish << "}";
+            sep = ",\n";
+        }
+        out << "\n  ],\n  \"criticalPath\": [";
+        sep = "";
+        for(const ModuleLine* l : criticalPath)
+        {
+            out << sep << str(l->_module->manifest()._name);
+            sep = ", ";
+        }
+        out << "],\n  \"daemons\": [";
+        sep = "\n";
+        for(const DaemonMoments& d : _daemonMoments)
+        {
+            out << sep << "    {\"name\": " << str(d._name)
+                << ", \"create\": " << us(d._creating, d._created)
+                << ", \"setName\": " << us(d._created, d._named)
+                << ", \"start\": " << us(d._named, d._started)
+                << ", \"finish\": " << us(_runMoment, d._started) << "}";
+            sep = ",\n";
+        }
+        out << "\n  ]\n}\n";
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     bool Manager::initializeModules()
     {
+        //повторный вызов после preload
+        if(_modulesInitialized)
+        {
+            return *_modulesInitialized;
+        }
+
         fs::path modulesDir = fs::current_path() / "../module";
 
         if(!fs::exists(modulesDir))
@@ -480,46 +1573,378 @@ namespace dci::host::impl
             return false;
         }
 
-        bool hasFails = false;
+        const auto startMoment = std::chrono::steady_clock::now();
+
+        std::vector<fs::path> manifestPaths;
+        for(const fs::directory_entry& de : fs::directory_iterator(modulesDir))
+        {
+            if(".manifest" != de.path().extension())
+                continue;
+
+            manifestPaths.emplace_back(de.path());
+        }
+
+        //порядок обхода каталога не определен, а регистрация должна быть воспроизводимой
+        std::sort(manifestPaths.begin(), manifestPaths.end());
+
+        ManifestIndex index{modulesDir / ".index"};
+        index.load();
+
+        std::vector<ModulePtr> modules(manifestPaths.size());
+        std::vector<char> attached(manifestPaths.size(), false);
+        std::vector<char> fromIndex(manifestPaths.size(), false);
+        std::vector<ManifestIndex::Stamp> stamps(manifestPaths.size());
+        std::vector<ManifestIndex::Stamp> binaryStamps(manifestPaths.size());
+
+        try
+        {
+            parallelFor(manifestPaths.size(), [&](std::size_t i)
+            {
+                std::error_code ec;
+                stamps[i] = ManifestIndex::stamp(manifestPaths[i], ec);
+                if(ec)
+                    return;
+
+                modules[i] = std::make_shared<Module>(this, manifestPaths[i]);
+
+                module::Manifest cached;
+                ManifestIndex::Stamp cachedBinaryStamp;
+                if(index.find(manifestPaths[i].filename().string(), stamps[i], cached, cachedBinaryStamp))
+                {
+                    binaryStamps[i] = ManifestIndex::stamp(manifestPaths[i].parent_path() / cached._mainBinary, ec);
+                    attached[i] = modules[i]->attach(std::move(cached));
+
+                    //бинарник не менялся с прошлой сверки - файл манифеста и бинарник не читаются
+                    fromIndex[i] = attached[i] && !ec && binaryStamps[i] == cachedBinaryStamp;
+                }
+                else
+                {
+                    attached[i] = modules[i]->attach();
+                }
+
+                if(!attached[i] || fromIndex[i])
+                    return;
+
+                try
+                {
+                    modules[i]->verifyBinary();
+                }
+                catch(...)
+                {
+                    LOGE("modules initialization: "<<manifestPaths[i]<<": "<<dci::exception::currentToString());
+                    attached[i] = false;
+                    return;
+                }
 
-        fs::directory_iterator diter(modulesDir);
-        fs::directory_iterator dend;
-        for(; diter!=dend; ++diter)
+                binaryStamps[i] = ManifestIndex::stamp(manifestPaths[i].parent_path() / modules[i]->manifest()._mainBinary, ec);
+            }, _helperCpus);
+        }
+        catch(...)
         {
-            const fs::path manifestPath = diter->path();
+            LOGE("modules initialization: "<<dci::exception::currentToString());
+            return false;
+        }
+
+        bool hasFails = false;
 
-            if(".manifest" != manifestPath.extension())
+        for(std::size_t i{}; i<modules.size(); ++i)
+        {
+            ModulePtr& module = modules[i];
+            if(!module)
                 continue;
 
-            if(!fs::is_regular_file(manifestPath))
+            if(!attached[i])
+            {
+                LOGE("modules initialization: unable to attach " << manifestPaths[i]);
+                hasFails = true;
                 continue;
+            }
 
-            ModulePtr module = std::make_unique<Module>(this, manifestPath);
+            registerModule(module.get());
 
-            if(!module->attach())
+            if(!fromIndex[i])
+            {
+                index.put(manifestPaths[i].filename().string(), stamps[i], binaryStamps[i], module->manifest());
+            }
+
+            _modules.emplace_back(std::move(module));
+        }
+
+        _services.freeze();
+        notifyChanged(Change::modules);
+        notifyChanged(Change::services);
+
+        {
+            std::set<std::string> present;
+            for(const ModulePtr& module : _modules)
+            {
+                present.emplace(module->manifestFile().filename().string());
+            }
+            index.retain(present);
+            index.save();
+        }
+
+        LOGI("modules initialization: "<<_modules.size()<<" of "<<manifestPaths.size()<<" manifests ("
+             <<std::count(fromIndex.begin(), fromIndex.end(), true)<<" from index) in "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startMoment).count()<<"us, "
+             <<parallelism(manifestPaths.size())<<" threads");
+
+        _modulesInitialized = !hasFails;
+        return !hasFails;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::registerModule(Module* module)
+    {
+        const module::Manifest& manifest = module->manifest();
+        _modulesByName.emplace(manifest._name, module);
+
+        for(const module::Manifest::ServiceId& serviceId : manifest._serviceIds)
+        {
+            idl::ILid ilid{idl::contract::lidRegistry.emplace(serviceId._iid._cid), serviceId._iid._side};
+            _services.addProvider(ilid, module);
+            if(!serviceId._alias.empty())
+            {
+                _services.addAlias(serviceId._alias, ilid);
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::preload()
+    {
+        if(!initializeModules())
+        {
+            return false;
+        }
+
+        const auto startMoment = std::chrono::steady_clock::now();
+
+        std::vector<std::string> binaries;
+        for(const ModulePtr& module : _modules)
+        {
+            if(Module::State::attached == module->state())
+            {
+                binaries.emplace_back((module->manifestFile().parent_path() / module->manifest()._mainBinary).string());
+            }
+        }
+
+        //страницы читаются параллельно, а сам dlopen с конструкторами модулей - только здесь, в потоке цикла
+        parallelFor(binaries.size(), [&](std::size_t i)
+        {
+            dllPrefetch(binaries[i]);
+        }, _helperCpus);
+
+        //только dlopen и релокации, Entry::load остается за процессом, который будет модуль запускать
+        std::size_t fails {};
+        for(const std::string& binary : binaries)
+        {
+            try
+            {
+                dll(binary);
+            }
+            catch(const std::runtime_error& e)
+            {
+                LOGW("preload "<<binary<<": "<<e.what());
+                ++fails;
+            }
+        }
+
+        LOGI("preload: "<<binaries.size()-fails<<" of "<<binaries.size()<<" module binaries in "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startMoment).count()<<"us");
+
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Module* Manager::requiredProvider(const std::string& require)
+    {
+        idl::ILid ilid;
+
+        idl::IId iid;
+        if(iid.fromText(require))
+        {
+            ilid = idl::ILid{idl::contract::lidRegistry.get(iid._cid), iid._side};
+        }
+        else
+        {
+            const idl::ILid* aliased = _services.alias(require);
+            if(!aliased)
+            {
+                return nullptr;
+            }
+            ilid = *aliased;
+        }
+
+        return _services.provider(ilid);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::buildStartLevels(const std::vector<Module*>& selected, std::vector<std::vector<Module*>>& levels)
+    {
+        //замыкание выбранных модулей по requires, ребро ведет к поставщику
+        std::map<Module*, std::set<Module*>> deps;
+        std::vector<Module*> queue{selected};
+        bool ok = true;
+
+        while(!queue.empty())
+        {
+            Module* m = queue.back();
+            queue.pop_back();
+
+            if(deps.contains(m))
             {
-                LOGE("modules initialization: unable to attach " << manifestPath);
-                hasFails = true;
                 continue;
             }
 
-            const module::Manifest& manifest = module->manifest();
-            _modulesByName.emplace(manifest._name, module.get());
+            std::set<Module*>& mdeps = deps[m];
+            for(const std::string& require : m->manifest()._requires)
+            {
+                Module* provider = requiredProvider(require);
+                if(!provider)
+                {
+                    LOGE("start modules: \""<<m->manifest()._name<<"\" requires \""<<require<<"\", no provider");
+                    ok = false;
+                    continue;
+                }
 
-            for(const module::Manifest::ServiceId& serviceId : manifest._serviceIds)
+                if(provider != m)
+                {
+                    mdeps.insert(provider);
+                    queue.push_back(provider);
+                }
+            }
+        }
+
+        if(!ok)
+        {
+            return false;
+        }
+
+        while(!deps.empty())
+        {
+            std::vector<Module*> level;
+            for(const auto&[m, mdeps] : deps)
             {
-                idl::ILid ilid{idl::contract::lidRegistry.emplace(serviceId._iid._cid), serviceId._iid._side};
-                _serviceProviders.emplace(ilid, module.get());
-                if(!serviceId._alias.empty())
+                if(mdeps.empty())
                 {
-                    _serviceAliases.emplace(serviceId._alias, ilid);
+                    level.push_back(m);
                 }
             }
 
-            _modules.emplace_back(std::move(module));
+            if(level.empty())
+            {
+                std::string names;
+                for(const auto&[m, mdeps] : deps)
+                {
+                    names += names.empty() ? "\"" : ", \"";
+                    names += m->manifest()._name + "\"";
+                }
+
+                LOGE("start modules: dependency cycle among "<<names);
+                return false;
+            }
+
+            std::sort(level.begin(), level.end(), [](Module* a, Module* b)
+            {
+                return a->manifest()._name < b->manifest()._name;
+            });
+
+            for(Module* m : level)
+            {
+                deps.erase(m);
+            }
+
+            for(auto&[m, mdeps] : deps)
+            {
+                for(Module* l : level)
+                {
+                    mdeps.erase(l);
+                }
+            }
+
+            levels.emplace_back(std::move(level));
         }
 
-        return !hasFails;
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::drainModules(const std::vector<Module*>& modules)
+    {
+        if(modules.empty())
+        {
+            return;
+        }
+
+        std::vector<cmt::Future<>> requests;
+        requests.reserve(modules.size());
+        for(Module* module : modules)
+        {
+            requests.emplace_back(module->stopRequest());
+        }
+
+        const auto startMoment = std::chrono::steady_clock::now();
+
+        //общий на все модули срок, ожидание завершается по последнему запросу или по таймеру
+        struct Drain
+        {
+            std::size_t     _pending {};
+            cmt::Promise<>  _done;
+
+            void finish()
+            {
+                if(!_done.resolved())
+                {
+                    _done.resolveValue();
+                }
+            }
+        };
+        auto drain = std::make_shared<Drain>();
+
+        for(cmt::Future<>& request : requests)
+        {
+            if(request.resolved())
+            {
+                continue;
+            }
+
+            ++drain->_pending;
+            request.then() += [drain](auto)
+            {
+                if(!--drain->_pending)
+                {
+                    drain->finish();
+                }
+            };
+        }
+
+        if(drain->_pending && _drainTimeout.count() > 0)
+        {
+            poll::Timer timer{_drainTimeout};
+            timer.tick() += [drain]
+            {
+                drain->finish();
+            };
+            timer.start();
+
+            drain->_done.future().wait();
+            timer.stop();
+        }
+
+        std::size_t lagging {};
+        for(std::size_t i{}; i<modules.size(); ++i)
+        {
+            if(!requests[i].resolved())
+            {
+                ++lagging;
+                LOGW("drain: module \""<<modules[i]->manifest()._name<<"\" still holds "<<modules[i]->stopLocks()<<" stop locks");
+            }
+        }
+
+        LOGI("drain: "<<modules.size()-lagging<<" of "<<modules.size()<<" modules drained in "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startMoment).count()<<"us"
+             <<(lagging ? ", deadline reached" : ""));
     }
 
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -532,9 +1957,11 @@ namespace dci::host::impl
 
         _modules.clear();
         _modulesByName.clear();
-        _serviceProviders.clear();
-        _serviceAliases.clear();
+        _services.clear();
+        _modulesInitialized.reset();
 
+        notifyChanged(Change::modules);
+        notifyChanged(Change::services);
         return res;
     }
 
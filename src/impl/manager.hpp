@@ -8,11 +8,26 @@
 #pragma once
 
 #include <dci/host/test.hpp>
+#include <dci/host/manager.hpp>
 #include <dci/cmt.hpp>
 #include <dci/sbs/signal.hpp>
 #include <dci/sbs/wire.hpp>
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
 #include "module.hpp"
+#include "offload.hpp"
+#include "serviceRegistry.hpp"
+#include "watchdog.hpp"
+
+namespace dci::poll
+{
+    class Awaker;
+    class Timer;
+}
 
 namespace dci::idl::gen::host
 {
@@ -26,6 +41,7 @@ namespace dci::host::impl
     public:
         static int executeTest(const std::vector<std::string>& argv, TestStage stage, host::Manager* manager);
         static const module::Manifest& moduleManifest(const std::string& mainBinaryFullPath);
+        static bool verifyModules();
 
     public:
         Manager();
@@ -34,20 +50,61 @@ namespace dci::host::impl
         void run();//блокирующий
         void stop();//запрос на выход из run
 
+        void loadThreads(std::size_t amount);
+        void offloadThreads(std::size_t amount);
+        void drainTimeout(std::chrono::milliseconds timeout);
+        void restartDowntime(std::chrono::microseconds downtime);
+        void watchdog(std::chrono::milliseconds stall, std::chrono::milliseconds abort);
+        bool placement(const std::string& loopCpus, const std::string& helperCpus, int numaNode);
+        Offload& offload();
+
+        void fiberStatsInterval(std::chrono::milliseconds interval);
+        const FiberStats& fiberStats();
+        const LoopStats& loopStats();
+
+        //для Introspection: что изменилось в составе модулей, сервисов, демонов
+        enum class Change
+        {
+            modules,
+            services,
+            daemons,
+        };
+        sbs::Signal<void, Change> changed();
+        void notifyChanged(Change what);
+
+        sbs::Signal<> binariesChanged();
+
+        bool post(std::function<void()>&& f);
+        cmt::Future<> runOffloaded(std::function<void()>&& job);
+
+        bool preload();
         bool startModules(std::set<std::string>&& byNames, std::set<std::string>&& byServices);
 
         cmt::Future<int> runTest(const std::vector<std::string>& argv, TestStage stage);
         cmt::Future<> runDaemon(const std::vector<std::string>& argv);
         cmt::Future<> runDaemons(const std::vector<std::string>& argv);
 
+        cmt::Future<> reloadModule(const std::string& name);
+
         cmt::Future<idl::Interface> createService(idl::ILid ilid);
-        cmt::Future<idl::Interface> createService(const std::string& alias);
+        cmt::Future<idl::Interface> createService(std::string_view alias);
+        cmt::Future<std::vector<cmt::Future<idl::Interface>>> createServices(const std::vector<host::Manager::ServiceRequest>& requests);
         cmt::Future<idl::Interface> getDaemonService(const std::string& name);
 
+        void startupReport(const std::string& jsonFile);
+
     private:
+        friend class Introspection;
+        friend class MetricsDaemon;
+
         bool initializeModules();
+        void registerModule(Module* module);
+        void drainModules(const std::vector<Module*>& modules);
         bool deinitializeModules();
 
+        Module* requiredProvider(const std::string& require);
+        bool buildStartLevels(const std::vector<Module*>& selected, std::vector<std::vector<Module*>>& levels);
+
         template <class Modules, class F>
         bool massModulesOperation(const Modules& modules, const std::string& name, const F& operation);
 
@@ -61,16 +118,96 @@ namespace dci::host::impl
         } _workState = WorkState::stopped;
 
     private:
+        std::optional<bool>                     _modulesInitialized;
         std::vector<ModulePtr>                  _modules;
         std::map<std::string, Module*>          _modulesByName;
-        std::multimap<idl::ILid, Module*>       _serviceProviders;
-        std::multimap<std::string, idl::ILid>   _serviceAliases;
+        ServiceRegistry                         _services;
 
     private:
         using Daemon = dci::idl::gen::host::Daemon<idl::ISide::primary>;
-        using Daemons = std::multimap<std::string, Daemon>;
+        struct DaemonInstance
+        {
+            Daemon                      _daemon;
+            Module*                     _module {};
+            std::vector<std::string>    _argv;//для перезапуска при перезагрузке модуля
+        };
+        using Daemons = std::multimap<std::string, DaemonInstance>;
         Daemons _daemons;
 
+    private:
+        struct DaemonMoments
+        {
+            std::string                             _name;
+            std::chrono::steady_clock::time_point   _creating;
+            std::chrono::steady_clock::time_point   _created;
+            std::chrono::steady_clock::time_point   _named;
+            std::chrono::steady_clock::time_point   _started;
+        };
+
+        std::chrono::steady_clock::time_point   _runMoment;
+        std::chrono::steady_clock::time_point   _modulesInitializedMoment;
+        std::optional<std::chrono::microseconds> _restartDowntime;//если процесс запущен перезапуском на обновление
+        std::vector<DaemonMoments>              _daemonMoments;
+
+    private:
+        void applyPlacement();
+
+        std::vector<std::size_t>    _loopCpus;
+        std::vector<std::size_t>    _helperCpus;
+        int                         _numaNode = -1;
+        std::string                 _placementApplied;
+
+    private:
+        std::chrono::milliseconds _drainTimeout {5000};
+
+    private:
+        void sampleFibers();
+
+        std::chrono::milliseconds       _fiberStatsInterval {1000};
+        FiberStats                      _fiberStats;
+        std::unique_ptr<poll::Timer>    _fiberStatsTimer;
+        sbs::Owner                      _fiberStatsSol;
+        bool                            _fiberStatsDue {};
+
+    private:
+        //члены не зависят от DCI_HOST_LOOP_STATS, раскладка impl одна для любой сборки
+        void startLagProbe();
+
+        LoopStats                               _loopStats;
+        std::unique_ptr<poll::Timer>            _lagProbe;
+        std::chrono::steady_clock::time_point   _lagProbeDue;
+        sbs::Owner                              _lagProbeSol;
+
+    private:
+        Watchdog _watchdog;
+
+    private:
+        std::size_t _loadThreads {};
+        std::size_t _offloadThreads {};
+        Offload     _offload;
+
+    private:
+        //переходы в поток цикла из других потоков
+        std::mutex                          _hopsMtx;
+        std::vector<std::function<void()>>  _hops;
+        std::unique_ptr<poll::Awaker>       _hopsAwaker;
+        sbs::Owner                          _hopsSol;
+
+    private:
+        sbs::Wire<void, Change> _changed;
+        sbs::Wire<>             _binariesChanged;
+
+        //сторожу: по какому бинарнику какой модуль и демоны, при изменении состава модулей и демонов
+        void updateWatchdogBinaries();
+
+    private:
+        struct ServiceStats
+        {
+            std::uint64_t   _calls {};
+            std::uint64_t   _failures {};
+            Histogram       _latency;//наносекунд до готовности результата
+        } _serviceStats;
+
     private:
         cmt::task::Owner _workersOwner;
     };
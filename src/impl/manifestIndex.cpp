@@ -0,0 +1,503 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "manifestIndex.hpp"
+#include <dci/logger.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <type_traits>
+
+#if __has_include(<sys/mman.h>)
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   define DCI_HOST_MANIFESTINDEX_MMAP 1
+#endif
+
+namespace dci::host::impl
+{
+    namespace fs = std::filesystem;
+
+    namespace
+    {
+        /*
+            header:     magic[8], uint32 iidSize, uint32 entriesAmount
+            entry:      int64 mtime, uint64 size, int64 binaryMtime, uint64 binarySize, str file, body
+            body:       str name, str mainBinary,
+                        uint32 idsAmount, {iid[iidSize], str alias}...,
+                        uint32 requiresAmount, {str require}...,
+                        uint64 arenaReserve
+            str:        uint32 len, char[len]
+            записи упорядочены по file
+        */
+        constexpr char magic[8] = {'d','c','i','h','m','i','x','4'};
+
+        static_assert(std::is_trivially_copyable_v<idl::IId>);
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        struct Reader
+        {
+            const char* _pos;
+            const char* _end;
+
+            bool raw(void* dst, std::size_t size)
+            {
+                if(static_cast<std::size_t>(_end - _pos) < size)
+                {
+                    return false;
+                }
+
+                std::memcpy(dst, _pos, size);
+                _pos += size;
+                return true;
+            }
+
+            bool skip(std::size_t size)
+            {
+                if(static_cast<std::size_t>(_end - _pos) < size)
+                {
+                    return false;
+                }
+
+                _pos += size;
+                return true;
+            }
+
+            template <class T>
+            bool pod(T& v)
+            {
+                return raw(&v, sizeof(T));
+            }
+
+            bool view(std::string_view& v)
+            {
+                std::uint32_t len;
+                if(!pod(len) || static_cast<std::size_t>(_end - _pos) < len)
+                {
+                    return false;
+                }
+
+                v = std::string_view{_pos, len};
+                _pos += len;
+                return true;
+            }
+
+            bool str(std::string& v)
+            {
+                std::string_view sv;
+                if(!view(sv))
+                {
+                    return false;
+                }
+
+                v.assign(sv);
+                return true;
+            }
+
+            //разметка без разбора
+            bool skipBody()
+            {
+                std::string_view sv;
+                std::uint32_t idsAmount;
+                if(!view(sv) || !view(sv) || !pod(idsAmount))
+                {
+                    return false;
+                }
+
+                for(std::uint32_t j{}; j<idsAmount; ++j)
+                {
+                    if(!skip(sizeof(idl::IId)) || !view(sv))
+                    {
+                        return false;
+                    }
+                }
+
+                std::uint32_t requiresAmount;
+                if(!pod(requiresAmount))
+                {
+                    return false;
+                }
+
+                for(std::uint32_t j{}; j<requiresAmount; ++j)
+                {
+                    if(!view(sv))
+                    {
+                        return false;
+                    }
+                }
+
+                return skip(sizeof(std::uint64_t));
+            }
+
+            bool body(module::Manifest& manifest)
+            {
+                manifest.reset();
+
+                std::uint32_t idsAmount;
+                bool ok = str(manifest._name) &&
+                          str(manifest._mainBinary) &&
+                          pod(idsAmount);
+
+                for(std::uint32_t j{}; ok && j<idsAmount; ++j)
+                {
+                    module::Manifest::ServiceId& id = manifest._serviceIds.emplace_back();
+                    ok = raw(&id._iid, sizeof(idl::IId)) && str(id._alias);
+                }
+
+                std::uint32_t requiresAmount {};
+                ok = ok && pod(requiresAmount);
+                for(std::uint32_t j{}; ok && j<requiresAmount; ++j)
+                {
+                    ok = str(manifest._requires.emplace_back());
+                }
+
+                std::uint64_t arenaReserve {};
+                ok = ok && pod(arenaReserve);
+                manifest._arenaReserve = static_cast<std::size_t>(arenaReserve);
+
+                manifest._valid = ok;
+                return ok;
+            }
+        };
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        struct Writer
+        {
+            std::string _out;
+
+            template <class T>
+            void pod(const T& v)
+            {
+                _out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+            }
+
+            void str(std::string_view v)
+            {
+                pod(static_cast<std::uint32_t>(v.size()));
+                _out.append(v);
+            }
+
+            void body(const module::Manifest& manifest)
+            {
+                str(manifest._name);
+                str(manifest._mainBinary);
+                pod(static_cast<std::uint32_t>(manifest._serviceIds.size()));
+                for(const module::Manifest::ServiceId& id : manifest._serviceIds)
+                {
+                    _out.append(reinterpret_cast<const char*>(&id._iid), sizeof(idl::IId));
+                    str(id._alias);
+                }
+                pod(static_cast<std::uint32_t>(manifest._requires.size()));
+                for(const std::string& require : manifest._requires)
+                {
+                    str(require);
+                }
+                pod(static_cast<std::uint64_t>(manifest._arenaReserve));
+            }
+        };
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //уникальное имя на каждую запись: параллельные хосты, воркеры и сборка не пишут в один файл
+        bool writeReplace(const fs::path& file, const std::string& content)
+        {
+#ifdef DCI_HOST_MANIFESTINDEX_MMAP
+            std::string tmp = file.string() + ".XXXXXX";
+            int fd = ::mkstemp(tmp.data());
+            if(0 > fd)
+            {
+                LOGW("manifest index "<<file<<": unable to create temporary file, "<<std::strerror(errno));
+                return false;
+            }
+            ::fchmod(fd, 0644);
+
+            bool ok = true;
+            for(std::size_t done{}; ok && done < content.size();)
+            {
+                ssize_t res = ::write(fd, content.data() + done, content.size() - done);
+                if(0 > res && EINTR == errno)
+                {
+                    continue;
+                }
+                ok = 0 < res;
+                done += ok ? static_cast<std::size_t>(res) : 0;
+            }
+            ok = !::close(fd) && ok;
+#else
+            std::string tmp = file.string() + "." + std::to_string(std::random_device{}());
+            bool ok;
+            {
+                std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+                ok = out && out.write(content.data(), static_cast<std::streamsize>(content.size()));
+            }
+#endif
+
+            std::error_code ec;
+            if(!ok)
+            {
+                LOGW("manifest index "<<file<<": unable to write");
+                fs::remove(tmp, ec);
+                return false;
+            }
+
+            fs::rename(tmp, file, ec);
+            if(ec)
+            {
+                LOGW("manifest index "<<file<<": unable to replace, "<<ec.message());
+                fs::remove(tmp, ec);
+                return false;
+            }
+
+            return true;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    class ManifestIndex::MappedFile
+    {
+    public:
+        MappedFile(const fs::path& path)
+        {
+#ifdef DCI_HOST_MANIFESTINDEX_MMAP
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if(0 > fd)
+            {
+                return;
+            }
+
+            struct stat st;
+            if(!::fstat(fd, &st) && st.st_size > 0)
+            {
+                void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if(MAP_FAILED != p)
+                {
+                    _data = static_cast<const char*>(p);
+                    _size = static_cast<std::size_t>(st.st_size);
+                }
+            }
+
+            ::close(fd);
+#else
+            std::ifstream in{path, std::ios::binary};
+            _buffer.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+            _data = _buffer.data();
+            _size = _buffer.size();
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef DCI_HOST_MANIFESTINDEX_MMAP
+            if(_data)
+            {
+                ::munmap(const_cast<char*>(_data), _size);
+            }
+#endif
+        }
+
+        const char* data() const { return _data; }
+        std::size_t size() const { return _size; }
+
+    private:
+        const char*         _data {};
+        std::size_t         _size {};
+#ifndef DCI_HOST_MANIFESTINDEX_MMAP
+        std::vector<char>   _buffer;
+#endif
+    };
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    ManifestIndex::Stamp ManifestIndex::stamp(const fs::path& file, std::error_code& ec)
+    {
+        Stamp res;
+
+        if(!fs::is_regular_file(file, ec))
+        {
+            if(!ec)
+            {
+                ec = std::make_error_code(std::errc::not_supported);
+            }
+            return res;
+        }
+
+        res._size = static_cast<std::uint64_t>(fs::file_size(file, ec));
+        if(ec)
+        {
+            return res;
+        }
+
+        res._mtime = static_cast<std::int64_t>(fs::last_write_time(file, ec).time_since_epoch().count());
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    ManifestIndex::ManifestIndex(const fs::path& file)
+        : _file(file)
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    ManifestIndex::~ManifestIndex()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool ManifestIndex::load()
+    {
+        _entries.clear();
+        _owned.clear();
+        _dirty = false;
+
+        _mapped = std::make_unique<MappedFile>(_file);
+        if(!_mapped->data())
+        {
+            _dirty = true;
+            return false;
+        }
+
+        Reader r{_mapped->data(), _mapped->data() + _mapped->size()};
+
+        char fileMagic[sizeof(magic)];
+        std::uint32_t iidSize;
+        std::uint32_t entriesAmount;
+        if(!r.raw(fileMagic, sizeof(fileMagic)) || std::memcmp(fileMagic, magic, sizeof(magic)) ||
+           !r.pod(iidSize) || sizeof(idl::IId) != iidSize ||
+           !r.pod(entriesAmount))
+        {
+            LOGW("manifest index "<<_file<<": bad header, ignored");
+            _dirty = true;
+            return false;
+        }
+
+        _entries.reserve(entriesAmount);
+        for(std::uint32_t i{}; i<entriesAmount; ++i)
+        {
+            Entry& entry = _entries.emplace_back();
+
+            bool ok = r.pod(entry._stamp._mtime) &&
+                      r.pod(entry._stamp._size) &&
+                      r.pod(entry._binaryStamp._mtime) &&
+                      r.pod(entry._binaryStamp._size) &&
+                      r.view(entry._fileName);
+
+            const char* bodyBegin = r._pos;
+            ok = ok && r.skipBody();
+
+            if(!ok)
+            {
+                LOGW("manifest index "<<_file<<": truncated, ignored");
+                _entries.clear();
+                _dirty = true;
+                return false;
+            }
+
+            entry._body = std::string_view{bodyBegin, static_cast<std::size_t>(r._pos - bodyBegin)};
+        }
+
+        auto less = [](const Entry& a, const Entry& b){return a._fileName < b._fileName;};
+        if(!std::is_sorted(_entries.begin(), _entries.end(), less))
+        {
+            std::sort(_entries.begin(), _entries.end(), less);
+            _dirty = true;
+        }
+
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool ManifestIndex::save()
+    {
+        if(!_dirty)
+        {
+            return true;
+        }
+
+        Writer w;
+        w._out.append(magic, sizeof(magic));
+        w.pod(static_cast<std::uint32_t>(sizeof(idl::IId)));
+        w.pod(static_cast<std::uint32_t>(_entries.size()));
+
+        for(const Entry& entry : _entries)
+        {
+            w.pod(entry._stamp._mtime);
+            w.pod(entry._stamp._size);
+            w.pod(entry._binaryStamp._mtime);
+            w.pod(entry._binaryStamp._size);
+            w.str(entry._fileName);
+            w._out.append(entry._body);
+        }
+
+        //тела прежних записей переносятся байтами из отображения, отображение переживает rename
+        if(!writeReplace(_file, w._out))
+        {
+            return false;
+        }
+
+        _dirty = false;
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool ManifestIndex::find(std::string_view manifestFileName, const Stamp& stamp, module::Manifest& manifest, Stamp& binaryStamp) const
+    {
+        auto iter = lookup(manifestFileName);
+        if(_entries.end() == iter || iter->_fileName != manifestFileName || iter->_stamp != stamp)
+        {
+            return false;
+        }
+
+        binaryStamp = iter->_binaryStamp;
+
+        Reader r{iter->_body.data(), iter->_body.data() + iter->_body.size()};
+        return r.body(manifest);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ManifestIndex::put(const std::string& manifestFileName, const Stamp& stamp, const Stamp& binaryStamp, const module::Manifest& manifest)
+    {
+        Writer w;
+        w.body(manifest);
+        std::string_view body = _owned.emplace_back(std::move(w._out));
+
+        auto iter = _entries.begin() + (lookup(manifestFileName) - _entries.cbegin());
+        if(_entries.end() == iter || iter->_fileName != manifestFileName)
+        {
+            iter = _entries.insert(iter, Entry{_owned.emplace_back(manifestFileName), {}, {}, {}});
+        }
+
+        iter->_stamp = stamp;
+        iter->_binaryStamp = binaryStamp;
+        iter->_body = body;
+        _dirty = true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ManifestIndex::retain(const std::set<std::string>& manifestFileNames)
+    {
+        std::size_t erased = std::erase_if(_entries, [&](const Entry& entry)
+        {
+            return !manifestFileNames.contains(std::string{entry._fileName});
+        });
+
+        if(erased)
+        {
+            _dirty = true;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<ManifestIndex::Entry>::const_iterator ManifestIndex::lookup(std::string_view manifestFileName) const
+    {
+        return std::lower_bound(_entries.begin(), _entries.end(), manifestFileName, [](const Entry& entry, std::string_view name)
+        {
+            return entry._fileName < name;
+        });
+    }
+}
@@ -0,0 +1,72 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <dci/host/module/manifest.hpp>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace dci::host::impl
+{
+    //бинарный кэш разобранных манифестов, ../module/.index
+    class ManifestIndex
+    {
+    public:
+        struct Stamp
+        {
+            std::int64_t    _mtime {};
+            std::uint64_t   _size {};
+
+            bool operator==(const Stamp&) const = default;
+        };
+
+        static Stamp stamp(const std::filesystem::path& file, std::error_code& ec);
+
+    public:
+        ManifestIndex(const std::filesystem::path& file);
+        ~ManifestIndex();
+
+        bool load();
+        bool save();
+
+        //потокобезопасен между load и первым put; разбирается только запрошенная запись;
+        //binaryStamp - отметка главного бинарника на момент put, сверяет ее вызывающий
+        bool find(std::string_view manifestFileName, const Stamp& stamp, module::Manifest& manifest, Stamp& binaryStamp) const;
+
+        void put(const std::string& manifestFileName, const Stamp& stamp, const Stamp& binaryStamp, const module::Manifest& manifest);
+        void retain(const std::set<std::string>& manifestFileNames);
+
+    private:
+        class MappedFile;
+
+        //load только размечает файл, тела записей остаются в отображении до find или save
+        struct Entry
+        {
+            std::string_view    _fileName;
+            Stamp               _stamp;
+            Stamp               _binaryStamp;
+            std::string_view    _body;//name, mainBinary, serviceIds, requires
+        };
+
+        std::vector<Entry>::const_iterator lookup(std::string_view manifestFileName) const;
+
+    private:
+        std::filesystem::path           _file;
+        std::unique_ptr<MappedFile>     _mapped;
+        std::deque<std::string>         _owned;//имена и тела записей из put
+        std::vector<Entry>              _entries;//по возрастанию _fileName
+        bool                            _dirty = false;
+    };
+}
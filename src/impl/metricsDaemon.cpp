@@ -0,0 +1,703 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "metricsDaemon.hpp"
+#include "manager.hpp"
+#include <dci/logger.hpp>
+#include <dci/config.hpp>
+#include "../placement.hpp"
+#include <boost/property_tree/ptree.hpp>
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string_view>
+
+#ifndef _WIN32
+#   include <sys/socket.h>
+#   include <sys/stat.h>
+#   include <sys/un.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <unistd.h>
+#   include <cerrno>
+#   define DCI_HOST_METRICS_SOCKETS 1
+#endif
+
+namespace dci::host::impl
+{
+    namespace
+    {
+        constexpr std::chrono::seconds renderTimeout{2};
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        //дописывает в переиспользуемый буфер, после первого снимка его емкости хватает и выделений нет
+        class Renderer
+        {
+        public:
+            Renderer(std::string& out)
+                : _out{out}
+            {
+                _out.clear();
+            }
+
+            void describe(std::string_view name, std::string_view type, std::string_view help)
+            {
+                _out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+                _out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+            }
+
+            Renderer& metric(std::string_view name, std::string_view suffix = {})
+            {
+                _out.append(name).append(suffix);
+                _labels = 0;
+                return *this;
+            }
+
+            Renderer& label(std::string_view key, std::string_view value)
+            {
+                _out += _labels++ ? ',' : '{';
+                _out.append(key).append("=\"");
+                for(char c : value)
+                {
+                    switch(c)
+                    {
+                    case '\\': _out.append("\\\\"); break;
+                    case '"':  _out.append("\\\""); break;
+                    case '\n': _out.append("\\n"); break;
+                    default: _out += c; break;
+                    }
+                }
+                _out += '"';
+                return *this;
+            }
+
+            template <class T>
+            void value(T v)
+            {
+                if(_labels)
+                {
+                    _out += '}';
+                }
+                _out += ' ';
+
+                char buf[32];
+                std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+                _out.append(buf, r.ptr);
+                _out += '\n';
+            }
+
+            //гистограмма в наносекундах как summary в секундах
+            void summary(std::string_view name, const Histogram& h)
+            {
+                Histogram::Summary s = h.summary();
+                constexpr double scale = 1e-9;
+
+                metric(name).label("quantile", "0.5").value(static_cast<double>(s._p50) * scale);
+                metric(name).label("quantile", "0.99").value(static_cast<double>(s._p99) * scale);
+                metric(name).label("quantile", "0.999").value(static_cast<double>(s._p999) * scale);
+                metric(name, "_sum").value(static_cast<double>(h.sum()) * scale);
+                metric(name, "_count").value(s._count);
+            }
+
+        private:
+            std::string&    _out;
+            std::size_t     _labels {};
+        };
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        constexpr std::string_view moduleStateNames[] =
+        {
+            "null",
+            "attached",
+            "attachError",
+            "loading",
+            "loaded",
+            "loadError",
+            "unloading",
+            "starting",
+            "started",
+            "startError",
+            "stopping",
+        };
+        static_assert(std::size(moduleStateNames) == Module::_statesAmount);
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        constexpr std::string_view daemonStateNames[] =
+        {
+            "null",
+            "starting",
+            "started",
+            "stopping",
+            "stopped",
+            "failed",
+        };
+        //в idl у перечисления нет количества, последним должен оставаться failed
+        static_assert(std::size(daemonStateNames) == static_cast<std::size_t>(idl::host::daemon::State::failed) + 1);
+        static_assert(daemonStateNames[static_cast<std::size_t>(idl::host::daemon::State::stopped)] == "stopped");
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        std::string_view daemonStateName(idl::host::daemon::State state)
+        {
+            std::size_t index = static_cast<std::size_t>(state);
+            return index < std::size(daemonStateNames) ? daemonStateNames[index] : std::string_view{"unknown"};
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    struct MetricsDaemon::Exchange
+    {
+        Manager *               _manager;
+        int                     _listenFd = -1;
+        std::string             _unixPath;
+#ifdef DCI_HOST_METRICS_SOCKETS
+        dev_t                   _unixDev {};//созданный bind файл сокета, при остановке удаляется только он
+        ino_t                   _unixIno {};
+#endif
+
+        std::mutex              _mtx;
+        std::condition_variable _cv;
+        bool                    _stopping {};
+        int                     _clientFd = -1;//обслуживаемое соединение, при остановке закрывается на чтение и запись
+        std::uint64_t           _requested {};
+        std::uint64_t           _rendered {};
+        std::string             _buffer;    //заполняется в потоке цикла под _mtx
+        std::string             _sending;   //только поток сервера; буферы меняются местами, емкость сохраняется
+
+        //только поток цикла: по слоту на демон, пересобираются по Manager::changed, состояние - по stateChanged демона
+        struct DaemonSlot
+        {
+            const void *                            _instance {};
+            std::string                             _name;
+            idl::host::daemon::State                _state = idl::host::daemon::State::null;
+            bool                                    _stateKnown {};
+            cmt::Future<idl::host::daemon::State>   _initialState;//для демонов, запущенных до host-metrics
+            sbs::Owner                              _sol;
+        };
+        std::list<DaemonSlot>   _daemonSlots;
+
+        static bool snapshot(const std::shared_ptr<Exchange>& self);
+        static void serve(std::shared_ptr<Exchange> self);
+    };
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    //в потоке цикла, по изменению состава демонов; выделения только на новые демоны
+    void MetricsDaemon::syncDaemons(Exchange& ex)
+    {
+        Manager& m = *ex._manager;
+
+        std::erase_if(ex._daemonSlots, [&](const Exchange::DaemonSlot& slot)
+        {
+            return std::none_of(m._daemons.begin(), m._daemons.end(), [&](const auto& nameInstance)
+            {
+                return &nameInstance.second == slot._instance;
+            });
+        });
+
+        for(const auto& [name, instance] : m._daemons)
+        {
+            if(!instance._daemon)
+            {
+                continue;
+            }
+
+            auto known = std::find_if(ex._daemonSlots.begin(), ex._daemonSlots.end(), [&](const Exchange::DaemonSlot& slot)
+            {
+                return &instance == slot._instance;
+            });
+            if(ex._daemonSlots.end() != known)
+            {
+                continue;
+            }
+
+            Exchange::DaemonSlot& slot = ex._daemonSlots.emplace_back();
+            slot._instance = &instance;
+            slot._name = name;
+
+            Exchange::DaemonSlot* slotPtr = &slot;
+            instance._daemon->stateChanged() += slot._sol * [slotPtr](idl::host::daemon::State state)
+            {
+                slotPtr->_state = state;
+                slotPtr->_stateKnown = true;
+            };
+
+            slot._initialState = instance._daemon->state();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    //в потоке цикла, в волокне
+    void MetricsDaemon::render(Exchange& ex)
+    {
+        Manager& m = *ex._manager;
+
+        for(Exchange::DaemonSlot& slot : ex._daemonSlots)
+        {
+            if(!slot._stateKnown && slot._initialState.resolved())
+            {
+                slot._state = slot._initialState.resolvedValue() ? slot._initialState.detachValue() : idl::host::daemon::State::failed;
+                slot._stateKnown = true;
+            }
+        }
+
+        std::lock_guard l{ex._mtx};
+
+        Renderer r{ex._buffer};
+
+        r.describe("dci_host_uptime_seconds", "gauge", "time since manager run");
+        r.metric("dci_host_uptime_seconds").value(std::chrono::duration<double>(std::chrono::steady_clock::now() - m._runMoment).count());
+
+        if(m._restartDowntime)
+        {
+            r.describe("dci_host_restart_downtime_seconds", "gauge", "from the stop of the previous process to the end of startup of this one, aup restart");
+            r.metric("dci_host_restart_downtime_seconds").value(std::chrono::duration<double>(*m._restartDowntime).count());
+        }
+
+        //модули
+        {
+            std::size_t counts[Module::_statesAmount] {};
+            for(const ModulePtr& module : m._modules)
+            {
+                ++counts[static_cast<std::size_t>(module->state())];
+            }
+
+            r.describe("dci_host_modules", "gauge", "modules by lifecycle state");
+            for(std::size_t i{}; i<Module::_statesAmount; ++i)
+            {
+                r.metric("dci_host_modules").label("state", moduleStateNames[i]).value(counts[i]);
+            }
+
+            r.describe("dci_host_module_state", "gauge", "current lifecycle state of a module");
+            for(const ModulePtr& module : m._modules)
+            {
+                r.metric("dci_host_module_state").label("module", module->manifest()._name).label("state", moduleStateNames[static_cast<std::size_t>(module->state())]).value(1);
+            }
+
+            r.describe("dci_host_module_stop_locks", "gauge", "stop locks held by a module");
+            for(const ModulePtr& module : m._modules)
+            {
+                r.metric("dci_host_module_stop_locks").label("module", module->manifest()._name).value(module->stopLocks());
+            }
+
+            r.describe("dci_host_module_arena_used_bytes", "gauge", "bytes in live service objects of a module");
+            for(const ModulePtr& module : m._modules)
+            {
+                if(const module::Arena* arena = module->arena())
+                {
+                    r.metric("dci_host_module_arena_used_bytes").label("module", module->manifest()._name).value(arena->stats()._used);
+                }
+            }
+        }
+
+        //создание сервисов
+        r.describe("dci_host_create_service_total", "counter", "createService calls");
+        r.metric("dci_host_create_service_total").value(m._serviceStats._calls);
+        r.describe("dci_host_create_service_failures_total", "counter", "createService calls resolved with an error");
+        r.metric("dci_host_create_service_failures_total").value(m._serviceStats._failures);
+        r.describe("dci_host_create_service_seconds", "summary", "createService latency");
+        r.summary("dci_host_create_service_seconds", m._serviceStats._latency);
+
+        //демоны
+        {
+            std::size_t counts[std::size(daemonStateNames)] {};
+            for(const Exchange::DaemonSlot& slot : ex._daemonSlots)
+            {
+                std::size_t index = static_cast<std::size_t>(slot._state);
+                if(index < std::size(counts))
+                {
+                    ++counts[index];
+                }
+            }
+
+            r.describe("dci_host_daemons", "gauge", "daemons by state");
+            for(std::size_t i{}; i<std::size(daemonStateNames); ++i)
+            {
+                r.metric("dci_host_daemons").label("state", daemonStateNames[i]).value(counts[i]);
+            }
+
+            r.describe("dci_host_daemon_state", "gauge", "current state of a daemon");
+            for(const Exchange::DaemonSlot& slot : ex._daemonSlots)
+            {
+                r.metric("dci_host_daemon_state").label("daemon", slot._name).label("state", daemonStateName(slot._state)).value(1);
+            }
+        }
+
+        //волокна и цикл
+        {
+            const FiberStats& fs = m._fiberStats;
+
+            r.describe("dci_host_fibers", "gauge", "fibers by state at the last sample");
+            r.metric("dci_host_fibers").label("state", "null").value(fs._null);
+            r.metric("dci_host_fibers").label("state", "ready").value(fs._ready);
+            r.metric("dci_host_fibers").label("state", "work").value(fs._work);
+            r.metric("dci_host_fibers").label("state", "hold").value(fs._hold);
+
+            r.describe("dci_host_fibers_peak", "gauge", "peak fibers amount");
+            r.metric("dci_host_fibers_peak").value(fs._peakTotal);
+
+            r.describe("dci_host_loop_batches_total", "counter", "executeReadyFibers calls");
+            r.metric("dci_host_loop_batches_total").value(fs._batches);
+
+            const LoopStats& ls = m._loopStats;
+            if(ls._enabled)
+            {
+                r.describe("dci_host_loop_wakeup_lag_seconds", "summary", "delay from timer readiness to its fiber run");
+                r.summary("dci_host_loop_wakeup_lag_seconds", ls._wakeupLag);
+
+                r.describe("dci_host_loop_batch_seconds", "summary", "duration of executeReadyFibers calls");
+                r.summary("dci_host_loop_batch_seconds", ls._batchDuration);
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    //в потоке сервера: заказ снимка в потоке цикла и ожидание; при успехе снимок в _sending
+    bool MetricsDaemon::Exchange::snapshot(const std::shared_ptr<Exchange>& self)
+    {
+        std::uint64_t generation;
+        {
+            std::lock_guard g{self->_mtx};
+            generation = ++self->_requested;
+        }
+
+        bool posted = self->_manager->post([self, generation]
+        {
+            render(*self);
+
+            {
+                std::lock_guard g{self->_mtx};
+                self->_rendered = std::max(self->_rendered, generation);
+            }
+            self->_cv.notify_all();
+        });
+
+        if(!posted)
+        {
+            return false;
+        }
+
+        std::unique_lock l{self->_mtx};
+        if(!self->_cv.wait_for(l, renderTimeout, [&]{return self->_rendered >= generation || self->_stopping;}) || self->_rendered < generation)
+        {
+            return false;
+        }
+
+        self->_sending.swap(self->_buffer);
+        return true;
+    }
+
+#ifdef DCI_HOST_METRICS_SOCKETS
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    namespace
+    {
+        bool writeAll(int fd, const char* data, std::size_t size)
+        {
+            while(size)
+            {
+                ssize_t w = ::send(fd, data, size, MSG_NOSIGNAL);
+                if(0 > w)
+                {
+                    if(EINTR == errno)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                data += w;
+                size -= static_cast<std::size_t>(w);
+            }
+            return true;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void MetricsDaemon::Exchange::serve(std::shared_ptr<Exchange> self)
+    {
+        constexpr std::string_view ok = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nConnection: close\r\nContent-Length: ";
+        constexpr std::string_view unavailable = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+
+        char request[2048];
+
+        for(;;)
+        {
+            int fd = ::accept(self->_listenFd, nullptr, nullptr);
+            if(0 > fd)
+            {
+                if(EINTR == errno || ECONNABORTED == errno)
+                {
+                    continue;
+                }
+
+                std::lock_guard g{self->_mtx};
+                if(!self->_stopping)
+                {
+                    LOGE("host-metrics: accept: "<<std::strerror(errno));
+                }
+                break;
+            }
+
+            {
+                //остановка не должна ждать таймаутов recv/send
+                std::lock_guard g{self->_mtx};
+                if(self->_stopping)
+                {
+                    ::close(fd);
+                    break;
+                }
+                self->_clientFd = fd;
+            }
+
+            timeval tv {static_cast<decltype(tv.tv_sec)>(renderTimeout.count()), 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+            //запрос не разбирается, любой ответ - полный снимок; читается только заголовок
+            std::size_t got {};
+            while(got < sizeof(request))
+            {
+                ssize_t r = ::recv(fd, request + got, sizeof(request) - got, 0);
+                if(0 >= r)
+                {
+                    break;
+                }
+                got += static_cast<std::size_t>(r);
+                if(std::string_view{request, got}.find("\r\n\r\n") != std::string_view::npos)
+                {
+                    break;
+                }
+            }
+
+            if(snapshot(self))
+            {
+                const std::string& body = self->_sending;
+
+                char length[32];
+                std::to_chars_result r = std::to_chars(length, length + sizeof(length), body.size());
+
+                static_cast<void>(
+                    writeAll(fd, ok.data(), ok.size()) &&
+                    writeAll(fd, length, static_cast<std::size_t>(r.ptr - length)) &&
+                    writeAll(fd, "\r\n\r\n", 4) &&
+                    writeAll(fd, body.data(), body.size()));
+            }
+            else
+            {
+                writeAll(fd, unavailable.data(), unavailable.size());
+            }
+
+            {
+                std::lock_guard g{self->_mtx};
+                self->_clientFd = -1;
+            }
+            ::close(fd);
+        }
+    }
+#endif
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    idl::Interface MetricsDaemon::create(Manager* manager)
+    {
+        MetricsDaemon* daemon = new MetricsDaemon{manager};
+        daemon->involvedChanged() += daemon->sol() * [daemon](bool v)
+        {
+            if(!v)
+            {
+                delete daemon;
+            }
+        };
+
+        return idl::Interface(daemon->opposite());
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    MetricsDaemon::MetricsDaemon(Manager* manager)
+        : _manager{manager}
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    MetricsDaemon::~MetricsDaemon()
+    {
+        stopImpl();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void MetricsDaemon::startImpl(idl::Config&& config)
+    {
+#ifdef DCI_HOST_METRICS_SOCKETS
+        _listen = config::cnvt(config).get<std::string>("listen", std::string{});
+        if(_listen.empty())
+        {
+            throw idl::host::daemon::Error{"host-metrics: listen=unix:<path> or listen=tcp:<port> expected"};
+        }
+
+        auto exchange = std::make_shared<Exchange>();
+        exchange->_manager = _manager;
+
+        auto fail = [&](const std::string& what)
+        {
+            std::string descr = "host-metrics: "+what+" "+_listen+": "+std::strerror(errno);
+            if(0 <= exchange->_listenFd)
+            {
+                ::close(exchange->_listenFd);
+            }
+            throw idl::host::daemon::Error{descr};
+        };
+
+        if(_listen.starts_with("unix:"))
+        {
+            sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+
+            exchange->_unixPath = _listen.substr(5);
+            if(exchange->_unixPath.empty() || exchange->_unixPath.size() >= sizeof(addr.sun_path))
+            {
+                throw idl::host::daemon::Error{"host-metrics: bad unix socket path "+_listen};
+            }
+            std::memcpy(addr.sun_path, exchange->_unixPath.data(), exchange->_unixPath.size());
+
+            exchange->_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if(0 > exchange->_listenFd)
+            {
+                fail("socket");
+            }
+
+            //сокет от предыдущего запуска удаляется, любой другой файл по этому пути - ошибка конфигурации
+            struct stat st;
+            if(!::lstat(exchange->_unixPath.c_str(), &st))
+            {
+                if(!S_ISSOCK(st.st_mode))
+                {
+                    errno = EEXIST;
+                    fail("not a socket");
+                }
+                ::unlink(exchange->_unixPath.c_str());
+            }
+
+            if(::bind(exchange->_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+            {
+                fail("bind");
+            }
+
+            if(!::lstat(exchange->_unixPath.c_str(), &st))
+            {
+                exchange->_unixDev = st.st_dev;
+                exchange->_unixIno = st.st_ino;
+            }
+        }
+        else
+        {
+            std::string_view port = _listen;
+            if(port.starts_with("tcp:"))
+            {
+                port.remove_prefix(4);
+            }
+
+            std::uint16_t portValue {};
+            if(std::from_chars(port.data(), port.data() + port.size(), portValue).ec != std::errc{} || !portValue)
+            {
+                throw idl::host::daemon::Error{"host-metrics: bad listen value "+_listen};
+            }
+
+            sockaddr_in addr {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(portValue);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            exchange->_listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if(0 > exchange->_listenFd)
+            {
+                fail("socket");
+            }
+
+            int one = 1;
+            ::setsockopt(exchange->_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            if(::bind(exchange->_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+            {
+                fail("bind");
+            }
+        }
+
+        if(::listen(exchange->_listenFd, 16))
+        {
+            fail("listen");
+        }
+
+        _exchange = exchange;
+
+        syncDaemons(*exchange);
+        _manager->changed() += _changedSol * [exchange](Manager::Change change)
+        {
+            if(Manager::Change::daemons == change)
+            {
+                syncDaemons(*exchange);
+            }
+        };
+
+        _thread = std::thread{[exchange]
+        {
+            //поток создается после привязки цикла к процессорам и не должен ее наследовать
+            std::string error;
+            if(!unpinCurrentThread(error))
+            {
+                LOGW("host-metrics: "<<error);
+            }
+
+            Exchange::serve(exchange);
+        }};
+
+        LOGI("host-metrics: listening on "<<_listen);
+#else
+        throw idl::host::daemon::Error{"host-metrics: not supported on this platform"};
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void MetricsDaemon::stopImpl()
+    {
+        if(!_exchange)
+        {
+            return;
+        }
+
+#ifdef DCI_HOST_METRICS_SOCKETS
+        //в потоке цикла: поток сервера будится во всех точках ожидания, поэтому join не ждет ни сети, ни снимка от цикла
+        {
+            std::lock_guard l{_exchange->_mtx};
+            _exchange->_stopping = true;
+
+            //recv/send в обслуживаемом соединении завершаются сразу
+            if(0 <= _exchange->_clientFd)
+            {
+                ::shutdown(_exchange->_clientFd, SHUT_RDWR);
+            }
+        }
+        //ожидание снимка в snapshot прерывается по _stopping
+        _exchange->_cv.notify_all();
+
+        //accept в потоке сервера возвращается с ошибкой
+        ::shutdown(_exchange->_listenFd, SHUT_RDWR);
+        _thread.join();
+        ::close(_exchange->_listenFd);
+
+        //путь мог быть занят заново другим процессом
+        struct stat st;
+        if(!_exchange->_unixPath.empty() && !::lstat(_exchange->_unixPath.c_str(), &st) &&
+           S_ISSOCK(st.st_mode) && st.st_dev == _exchange->_unixDev && st.st_ino == _exchange->_unixIno)
+        {
+            ::unlink(_exchange->_unixPath.c_str());
+        }
+#endif
+
+        _changedSol.flush();
+        _exchange->_daemonSlots.clear();
+        _exchange.reset();
+    }
+}
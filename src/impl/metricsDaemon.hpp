@@ -0,0 +1,50 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include "idl-host.hpp"
+#include <dci/host/daemonBase.hpp>
+#include <dci/sbs/owner.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dci::host::impl
+{
+    class Manager;
+
+    //встроенный демон host-metrics: счетчики и гистограммы Manager в текстовом формате Prometheus
+    //--run host-metrics listen=unix:/run/x.sock | listen=tcp:9100 (только петлевой интерфейс), listen берется из конфигурации start
+    //соединения принимает отдельный поток, снимок строится в потоке цикла через Manager::post
+    class MetricsDaemon
+        : public DaemonBase<MetricsDaemon>
+    {
+    public:
+        static constexpr const char* _builtinName = "host-metrics";
+        static idl::Interface create(Manager* manager);
+
+    public:
+        MetricsDaemon(Manager* manager);
+        ~MetricsDaemon();
+
+        void startImpl(idl::Config&& config);
+        void stopImpl();
+
+    private:
+        struct Exchange;
+        static void render(Exchange& ex);
+        static void syncDaemons(Exchange& ex);
+
+        Manager *                   _manager;
+        std::string                 _listen;
+        std::shared_ptr<Exchange>   _exchange;
+        std::thread                 _thread;
+        sbs::Owner                  _changedSol;
+    };
+}
@@ -12,6 +12,10 @@
 #include <dci/host/manager.hpp>
 #include <dci/logger.hpp>
 #include "../dll.hpp"
+#include "../elf.hpp"
+#include <fstream>
+#include <map>
+#include <mutex>
 
 namespace dci::host::impl
 {
@@ -25,6 +29,25 @@ namespace dci::host::impl
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     const module::Manifest& Module::manifest(const std::string& mainBinaryPath)
     {
+        //встроенный при сборке манифест читается без dlopen
+        {
+            std::string conf;
+            if(elfSection(mainBinaryPath, elfManifestSection, conf))
+            {
+                static std::mutex embeddedMtx;
+                static std::map<std::string, module::Manifest> embedded;
+
+                std::lock_guard l{embeddedMtx};
+                module::Manifest& manifest = embedded[mainBinaryPath];
+                if(manifest.fromConf(conf))
+                {
+                    return manifest;
+                }
+
+                LOGW("module "<<mainBinaryPath<<": malformed embedded manifest, fallback to load");
+            }
+        }
+
         boost::dll::shared_library* sl;
         try
         {
@@ -75,6 +98,43 @@ namespace dci::host::impl
         return _manifest;
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Module::State Module::state() const
+    {
+        return _state;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const Module::Moments& Module::moments() const
+    {
+        return _moments;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Module::stopRequested() const
+    {
+        return _stopRequested;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Module::stopLocks() const
+    {
+        return _entry ? _entry->stopLocks() : 0;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Module::setState(State state)
+    {
+        _state = state;
+        _moments._states[static_cast<std::size_t>(state)] = std::chrono::steady_clock::now();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const module::Arena* Module::arena() const
+    {
+        return _entry ? &_entry->arena() : nullptr;
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     bool Module::attach()
     {
@@ -93,17 +153,84 @@ namespace dci::host::impl
         case State::stopping:       return true;
         }
 
+        _moments._attaching = std::chrono::steady_clock::now();
+
         if(!_manifest.fromConfFile(_manifestFile.string()))
         {
-            _state = State::attachError;
+            setState(State::attachError);
             LOGE("unable to load module manifest");
             return false;
         }
 
-        _state = State::attached;
+        setState(State::attached);
         return true;
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Module::attach(module::Manifest&& manifest)
+    {
+        switch(_state)
+        {
+        case State::null:           break;
+        case State::attachError:    break;
+        default:                    return attach();
+        }
+
+        if(!manifest._valid)
+        {
+            return attach();
+        }
+
+        _moments._attaching = std::chrono::steady_clock::now();
+        _manifest = std::move(manifest);
+        setState(State::attached);
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Module::verifyBinary()
+    {
+        if(State::attached != _state)
+        {
+            return;
+        }
+
+        const fs::path mainBinaryPath = _manifestFile.parent_path()/_manifest._mainBinary;
+
+        std::string embedded;
+        if(!elfSection(mainBinaryPath.string(), elfManifestSection, embedded))
+        {
+            std::error_code ec;
+            if(!fs::is_regular_file(mainBinaryPath, ec))
+            {
+                LOGW("module \""<<_manifest._name<<"\": binary "<<mainBinaryPath<<" is absent");
+            }
+            return;
+        }
+
+        //секция - побайтовая копия файла манифеста из той же сборки
+        std::string onDisk;
+        {
+            std::ifstream in{_manifestFile, std::ios::binary};
+            onDisk.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+        }
+
+        if(embedded == onDisk)
+        {
+            return;
+        }
+
+        module::Manifest manifest;
+        if(!manifest.fromConf(embedded))
+        {
+            LOGW("module \""<<_manifest._name<<"\": malformed embedded manifest in "<<mainBinaryPath<<", ignored");
+            return;
+        }
+
+        LOGW("module \""<<_manifest._name<<"\": "<<_manifestFile<<" is stale, manifest embedded in binary is used");
+        _manifest = std::move(manifest);
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     bool Module::detach()
     {
@@ -125,7 +252,7 @@ namespace dci::host::impl
         }
 
         _manifest.reset();
-        _state = State::null;
+        setState(State::null);
         return true;
     }
 
@@ -149,10 +276,18 @@ namespace dci::host::impl
         case State::stopping:       return true;
         }
 
-        _state = State::loading;
+        setState(State::loading);
 
         fs::path mainBinaryPath = _manifestFile.parent_path()/_manifest._mainBinary;
 
+        //в пуле потоков только чтение файла; dlopen выполняет статические инициализаторы модуля,
+        //которым нужно окружение потока цикла (распределители, реестры), поэтому остается здесь
+        Offload& offload = _manager->offload();
+        if(offload.started())
+        {
+            offload.run([path=mainBinaryPath.string()]{dllPrefetch(path);}).wait();
+        }
+
         boost::dll::shared_library* sl;
         try
         {
@@ -161,7 +296,7 @@ namespace dci::host::impl
         catch(const std::runtime_error& e)
         {
             LOGE("loading module \""<<_manifest._name<<"\" binary: "<<e.what());
-            _state = State::loadError;
+            setState(State::loadError);
             return false;
         }
 
@@ -174,10 +309,14 @@ namespace dci::host::impl
         catch(const std::runtime_error& e)
         {
             LOGE("loading module "<<mainBinaryPath<<": entry point is absent, " << e.what());
-            _state = State::loadError;
+            setState(State::loadError);
             return false;
         }
 
+        _moments._resolved = std::chrono::steady_clock::now();
+
+        _entry->arena().reserveSize(_manifest._arenaReserve);
+
         if(!_entry->load())
         {
             LOGE("loading module \""<<_manifest._name<<"\": fail");
@@ -186,11 +325,11 @@ namespace dci::host::impl
 
             sl->unload();
 
-            _state = State::loadError;
+            setState(State::loadError);
             return false;
         }
 
-        _state = State::loaded;
+        setState(State::loaded);
 
         return true;
     }
@@ -215,7 +354,7 @@ namespace dci::host::impl
         case State::stopping:       return false;
         }
 
-        _state = State::unloading;
+        setState(State::unloading);
 
         if(_entry)
         {
@@ -224,10 +363,16 @@ namespace dci::host::impl
                 LOGE("unloading module \""<<_manifest._name<<"\": fail");
                 //ignore error
             }
+
+            module::Arena& arena = _entry->arena();
+            if(!arena.release())
+            {
+                LOGW("unloading module \""<<_manifest._name<<"\": "<<arena.stats()._used<<" bytes of services still alive, arena kept");
+            }
         }
 
         _entry  = nullptr;
-        _state = State::attached;
+        setState(State::attached);
 
         return true;
     }
@@ -252,18 +397,18 @@ namespace dci::host::impl
         case State::stopping:       return false;
         }
 
-        _state = State::starting;
+        setState(State::starting);
 
         dbgAssert(_entry);
 
         if(!_entry->start(himpl::impl2Face<host::Manager>(_manager)))
         {
             LOGE("starting module \""<<_manifest._name<<"\": fail");
-            _state = State::startError;
+            setState(State::startError);
             return false;
         }
 
-        _state = State::started;
+        setState(State::started);
 
         return true;
     }
@@ -282,13 +427,20 @@ namespace dci::host::impl
             return cmt::readyFuture();
         }
 
-        _state = State::stopping;
+        //состояние не меняется, жесткий stop остается возможен; новые сервисы уже не создаются
+        _stopRequested = true;
 
         dbgAssert(_entry);
 
         return _entry->stopRequest();
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Module::cancelStopRequest()
+    {
+        _stopRequested = false;
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     bool Module::stop()
     {
@@ -307,7 +459,7 @@ namespace dci::host::impl
         case State::stopping:       return false;
         }
 
-        _state = State::stopping;
+        setState(State::stopping);
 
         dbgAssert(_entry);
 
@@ -317,7 +469,8 @@ namespace dci::host::impl
             //ignore error
         }
 
-        _state = State::loaded;
+        _stopRequested = false;
+        setState(State::loaded);
         return true;
     }
 
@@ -337,6 +490,47 @@ namespace dci::host::impl
             return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService("module not started")));
         }
 
+        if(_stopRequested)
+        {
+            return cmt::readyFuture<idl::Interface>(std::make_exception_ptr(exception::UnableToCreateService("module is stopping")));
+        }
+
         return _entry->createService(ilid);
     }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::vector<cmt::Future<idl::Interface>> Module::createServices(const std::vector<idl::ILid>& ilids)
+    {
+        std::vector<cmt::Future<idl::Interface>> res;
+        res.reserve(ilids.size());
+
+        //состояние проверяется один раз на всю группу
+        std::exception_ptr fail;
+        if(State::attached == _state && !start())
+        {
+            fail = std::make_exception_ptr(exception::UnableToCreateService("unable to start module"));
+        }
+        else if(State::started != _state)
+        {
+            fail = std::make_exception_ptr(exception::UnableToCreateService("module not started"));
+        }
+        else if(_stopRequested)
+        {
+            fail = std::make_exception_ptr(exception::UnableToCreateService("module is stopping"));
+        }
+
+        for(const idl::ILid& ilid : ilids)
+        {
+            if(fail)
+            {
+                res.emplace_back(cmt::readyFuture<idl::Interface>(fail));
+            }
+            else
+            {
+                res.emplace_back(_entry->createService(ilid));
+            }
+        }
+
+        return res;
+    }
 }
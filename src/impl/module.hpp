@@ -10,8 +10,11 @@
 #include <dci/host/module/manifest.hpp>
 #include <dci/host/module/entry.hpp>
 #include <dci/cmt.hpp>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <filesystem>
+#include <vector>
 
 namespace dci::host::impl
 {
@@ -30,23 +33,24 @@ namespace dci::host::impl
         const module::Manifest& manifest() const;
 
         bool attach();
+        bool attach(module::Manifest&& manifest);
         bool detach();
 
+        //после attach: бинарник на месте, встроенный в него манифест совпадает с файлом; без dlopen
+        void verifyBinary();
+
         bool load();
         bool unload();
 
         bool start();
         cmt::Future<> stopRequest();
+        void cancelStopRequest();//модуль снова создает сервисы
         bool stop();
 
         cmt::Future<idl::Interface> createService(idl::ILid ilid);
+        std::vector<cmt::Future<idl::Interface>> createServices(const std::vector<idl::ILid>& ilids);
 
-    private:
-        Manager *                   _manager;
-        std::filesystem::path       _manifestFile;
-        module::Manifest            _manifest;
-        module::Entry *             _entry = nullptr;
-
+    public:
         enum class State
         {
             null,
@@ -63,8 +67,37 @@ namespace dci::host::impl
             started,
             startError,
             stopping,
-        } _state = State::null;
+        };
+        static constexpr std::size_t _statesAmount = static_cast<std::size_t>(State::stopping) + 1;
+
+        //монотонные моменты последнего перехода в каждое состояние
+        struct Moments
+        {
+            using TimePoint = std::chrono::steady_clock::time_point;
 
+            TimePoint _attaching;   //начало разбора манифеста
+            TimePoint _resolved;    //dlopen и точка входа получены
+            std::array<TimePoint, _statesAmount> _states;
+        };
+
+        State state() const;
+        const Moments& moments() const;
+
+        bool stopRequested() const;
+        std::size_t stopLocks() const;
+        const module::Arena* arena() const;//пока модуль загружен
+
+    private:
+        void setState(State state);
+
+    private:
+        Manager *                   _manager;
+        std::filesystem::path       _manifestFile;
+        module::Manifest            _manifest;
+        module::Entry *             _entry = nullptr;
+        State                       _state = State::null;
+        bool                        _stopRequested = false;
+        Moments                     _moments;
     };
 
     using ModulePtr = std::shared_ptr<Module>;
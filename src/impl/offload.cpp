@@ -0,0 +1,158 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "offload.hpp"
+#include <dci/poll/awaker.hpp>
+#include <dci/logger.hpp>
+#include "../placement.hpp"
+
+namespace dci::host::impl
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Offload::Offload()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Offload::~Offload()
+    {
+        stop();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Offload::cpus(const std::vector<std::size_t>& cpus)
+    {
+        _cpus = cpus;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Offload::start(std::size_t threadsAmount)
+    {
+        if(started() || !threadsAmount)
+        {
+            return;
+        }
+
+        _awaker = std::make_unique<poll::Awaker>(false);
+        _awaker->woken() += _sol * [this]
+        {
+            complete();
+        };
+
+        _stopping = false;
+        _threads.reserve(threadsAmount);
+        for(std::size_t i{}; i<threadsAmount; ++i)
+        {
+            _threads.emplace_back([this]{worker();});
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Offload::stop()
+    {
+        if(!started())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard l{_mtx};
+            _stopping = true;
+        }
+        _cv.notify_all();
+
+        for(std::thread& t : _threads)
+        {
+            t.join();
+        }
+        _threads.clear();
+
+        //недоделанное выполняется здесь же, чтобы ни одно обещание не осталось висеть
+        for(Task& task : _pending)
+        {
+            task._execute();
+            _completed.emplace_back(std::move(task._complete));
+        }
+        _pending.clear();
+
+        complete();
+
+        _sol.flush();
+        _awaker.reset();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Offload::started() const
+    {
+        return !_threads.empty();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Offload::post(std::function<void()>&& execute, std::function<void()>&& complete)
+    {
+        dbgAssert(started());
+
+        {
+            std::lock_guard l{_mtx};
+            _pending.emplace_back(Task{std::move(execute), std::move(complete)});
+        }
+        _cv.notify_one();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Offload::worker()
+    {
+        std::string error;
+        if(!pinHelperThread(_cpus, error))
+        {
+            LOGW("offload worker: "<<error);
+        }
+
+        for(;;)
+        {
+            Task task;
+
+            {
+                std::unique_lock l{_mtx};
+                _cv.wait(l, [this]{return _stopping || !_pending.empty();});
+
+                if(_pending.empty())
+                {
+                    return;
+                }
+
+                task = std::move(_pending.front());
+                _pending.pop_front();
+            }
+
+            task._execute();
+
+            {
+                std::lock_guard l{_mtx};
+                _completed.emplace_back(std::move(task._complete));
+            }
+
+            _awaker->wakeup();
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Offload::complete()
+    {
+        std::vector<std::function<void()>> completed;
+
+        {
+            std::lock_guard l{_mtx};
+            completed.swap(_completed);
+        }
+
+        for(std::function<void()>& c : completed)
+        {
+            c();
+        }
+    }
+}
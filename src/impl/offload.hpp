@@ -0,0 +1,130 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <dci/cmt.hpp>
+#include <dci/sbs/owner.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dci::poll
+{
+    class Awaker;
+}
+
+namespace dci::host::impl
+{
+    //ограниченный пул потоков ОС, результаты возвращаются в поток цикла через poll::Awaker
+    class Offload
+    {
+        Offload(const Offload&) = delete;
+        void operator=(const Offload&) = delete;
+
+    public:
+        Offload();
+        ~Offload();
+
+        void cpus(const std::vector<std::size_t>& cpus);//привязка рабочих потоков, пусто - привязка процесса, без привязки цикла
+        void start(std::size_t threadsAmount);
+        void stop();
+        bool started() const;
+
+        template <class F>
+        cmt::Future<std::invoke_result_t<F>> run(F&& f);
+
+    private:
+        void post(std::function<void()>&& execute, std::function<void()>&& complete);
+        void worker();
+        void complete();
+
+    private:
+        struct Task
+        {
+            std::function<void()> _execute;
+            std::function<void()> _complete;
+        };
+
+        std::mutex                      _mtx;
+        std::condition_variable         _cv;
+        std::deque<Task>                _pending;
+        std::vector<std::function<void()>> _completed;
+        bool                            _stopping = false;
+        std::vector<std::thread>        _threads;
+        std::vector<std::size_t>        _cpus;
+
+        std::unique_ptr<poll::Awaker>   _awaker;
+        sbs::Owner                      _sol;
+    };
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class F>
+    cmt::Future<std::invoke_result_t<F>> Offload::run(F&& f)
+    {
+        using T = std::invoke_result_t<F>;
+        using Stored = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+        struct Job
+        {
+            std::decay_t<F>         _f;
+            std::optional<Stored>   _value;
+            std::exception_ptr      _exception;
+            cmt::Promise<T>         _promise;
+        };
+
+        auto job = std::make_shared<Job>(Job{std::forward<F>(f), {}, {}, {}});
+        cmt::Future<T> res = job->_promise.future();
+
+        post(
+            [job]
+            {
+                try
+                {
+                    if constexpr(std::is_void_v<T>)
+                    {
+                        job->_f();
+                        job->_value.emplace(true);
+                    }
+                    else
+                    {
+                        job->_value.emplace(job->_f());
+                    }
+                }
+                catch(...)
+                {
+                    job->_exception = std::current_exception();
+                }
+            },
+            [job]
+            {
+                if(job->_exception)
+                {
+                    job->_promise.resolveException(std::move(job->_exception));
+                    return;
+                }
+
+                if constexpr(std::is_void_v<T>)
+                {
+                    job->_promise.resolveValue();
+                }
+                else
+                {
+                    job->_promise.resolveValue(std::move(*job->_value));
+                }
+            });
+
+        return res;
+    }
+}
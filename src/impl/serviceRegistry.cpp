@@ -0,0 +1,253 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "serviceRegistry.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace dci::host::impl
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    ServiceRegistry::ServiceRegistry()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    ServiceRegistry::~ServiceRegistry()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ServiceRegistry::clear()
+    {
+        _slots.clear();
+        _size = 0;
+        _registrations.clear();
+        _aliases.clear();
+        _frozen = false;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ServiceRegistry::addProvider(idl::ILid ilid, Module* module)
+    {
+        _registrations.emplace_back(ilid, module);
+
+        //заполнение не выше половины
+        if((_size+1)*2 > _slots.size())
+        {
+            rehash(std::max(std::size_t{16}, _slots.size()*2));
+        }
+
+        if(emplace(ilid, module))
+        {
+            ++_size;
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ServiceRegistry::addAlias(const std::string& alias, idl::ILid ilid)
+    {
+        _aliases.emplace_back(alias, ilid);
+        _frozen = false;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ServiceRegistry::removeModule(Module* module)
+    {
+        std::erase_if(_registrations, [module](const auto& r)
+        {
+            return module == r.second;
+        });
+
+        std::fill(_slots.begin(), _slots.end(), Slot{});
+        _size = 0;
+
+        for(const auto&[ilid, m] : _registrations)
+        {
+            if(emplace(ilid, m))
+            {
+                ++_size;
+            }
+        }
+
+        //алиасы, ведущие в никуда, уходят вместе с поставщиком
+        std::erase_if(_aliases, [this](const Alias& a)
+        {
+            return !provider(a.second);
+        });
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ServiceRegistry::freeze()
+    {
+        std::stable_sort(_aliases.begin(), _aliases.end(), [](const Alias& a, const Alias& b)
+        {
+            return a.first < b.first;
+        });
+
+        //повторы алиаса остаются: lower_bound находит первый зарегистрированный,
+        //а после removeModule его место занимает следующий
+        _aliases.shrink_to_fit();
+        _frozen = true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Module* ServiceRegistry::provider(idl::ILid ilid) const
+    {
+        if(_slots.empty())
+        {
+            return nullptr;
+        }
+
+        const std::size_t mask = _slots.size()-1;
+        for(std::size_t i = hash(ilid) & mask;; i = (i+1) & mask)
+        {
+            const Slot& slot = _slots[i];
+            if(!slot._module)
+            {
+                return nullptr;
+            }
+
+            if(slot._ilid == ilid)
+            {
+                return slot._module;
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const idl::ILid* ServiceRegistry::alias(std::string_view alias) const
+    {
+        if(!_frozen)
+        {
+            for(const Alias& a : _aliases)
+            {
+                if(a.first == alias)
+                {
+                    return &a.second;
+                }
+            }
+            return nullptr;
+        }
+
+        auto iter = std::lower_bound(_aliases.begin(), _aliases.end(), alias, [](const Alias& a, std::string_view v)
+        {
+            return std::string_view{a.first} < v;
+        });
+
+        if(_aliases.end() == iter || iter->first != alias)
+        {
+            return nullptr;
+        }
+
+        return &iter->second;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool ServiceRegistry::resolve(std::string_view text, idl::ILid& ilid) const
+    {
+        if(maybeIidText(text) && ilid.fromIidText(std::string{text}))
+        {
+            return true;
+        }
+
+        if(const idl::ILid* aliased = alias(text))
+        {
+            ilid = *aliased;
+            return true;
+        }
+
+        return false;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool ServiceRegistry::maybeIidText(std::string_view text)
+    {
+        //cid в hex (не меньше 32 цифр), разделители и сторона; алиасы так не выглядят
+        if(text.size() < 32 || text.size() > 64)
+        {
+            return false;
+        }
+
+        std::size_t hex{};
+        std::size_t other{};
+        for(char c : text)
+        {
+            if((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+            {
+                ++hex;
+            }
+            else if(c == '-' || c == '.' || c == '_' || (c >= 'g' && c <= 'z'))
+            {
+                ++other;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return hex >= 32 && other <= 8;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const std::vector<ServiceRegistry::Alias>& ServiceRegistry::aliases() const
+    {
+        return _aliases;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t ServiceRegistry::hash(idl::ILid ilid)
+    {
+        //fmix64 из murmur3
+        std::uint64_t k = (static_cast<std::uint64_t>(ilid._lid) << 8) ^ static_cast<std::uint64_t>(ilid._side);
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdull;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ull;
+        k ^= k >> 33;
+        return static_cast<std::size_t>(k);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void ServiceRegistry::rehash(std::size_t capacity)
+    {
+        capacity = std::bit_ceil(std::max(std::size_t{16}, capacity));
+
+        std::vector<Slot> slots(capacity);
+        slots.swap(_slots);
+
+        for(const Slot& slot : slots)
+        {
+            if(slot._module)
+            {
+                emplace(slot._ilid, slot._module);
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool ServiceRegistry::emplace(idl::ILid ilid, Module* module)
+    {
+        const std::size_t mask = _slots.size()-1;
+        for(std::size_t i = hash(ilid) & mask;; i = (i+1) & mask)
+        {
+            Slot& slot = _slots[i];
+            if(!slot._module)
+            {
+                slot._ilid = ilid;
+                slot._module = module;
+                return true;
+            }
+
+            if(slot._ilid == ilid)
+            {
+                return false;
+            }
+        }
+    }
+}
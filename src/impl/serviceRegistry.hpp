@@ -0,0 +1,89 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <dci/idl/iLid.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dci::host::impl
+{
+    class Module;
+
+    //поставщики сервисов по ILid (открытая адресация) и алиасы (отсортированный массив после freeze)
+    class ServiceRegistry
+    {
+    public:
+        using Alias = std::pair<std::string, idl::ILid>;
+
+    public:
+        ServiceRegistry();
+        ~ServiceRegistry();
+
+        void clear();
+
+        //при повторах отвечает первый зарегистрированный, как было с multimap::find;
+        //остальные хранятся и занимают его место после removeModule
+        void addProvider(idl::ILid ilid, Module* module);
+        void addAlias(const std::string& alias, idl::ILid ilid);
+        void removeModule(Module* module);
+
+        //до freeze поиск по алиасам недоступен
+        void freeze();
+
+        Module* provider(idl::ILid ilid) const;
+        const idl::ILid* alias(std::string_view alias) const;
+
+        //текст запроса сервиса: сначала как iid, затем как алиас; разбор iid только для текста похожего вида, без выделений памяти.
+        //true и пустой ilid - iid разобран, но интерфейс не зарегистрирован в lidRegistry
+        bool resolve(std::string_view text, idl::ILid& ilid) const;
+        static bool maybeIidText(std::string_view text);
+
+        const std::vector<Alias>& aliases() const;
+
+        template <class F>
+        void forEachProvider(F&& f) const;
+
+    private:
+        static std::size_t hash(idl::ILid ilid);
+        void rehash(std::size_t capacity);
+        bool emplace(idl::ILid ilid, Module* module);
+
+    private:
+        struct Slot
+        {
+            idl::ILid   _ilid {};
+            Module*     _module {};
+        };
+
+        std::vector<Slot>   _slots;
+        std::size_t         _size {};
+
+        //все регистрации по порядку, включая повторы; из них таблица перестраивается в removeModule
+        std::vector<std::pair<idl::ILid, Module*>> _registrations;
+
+        std::vector<Alias>  _aliases;
+        bool                _frozen = false;
+    };
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    template <class F>
+    void ServiceRegistry::forEachProvider(F&& f) const
+    {
+        for(const Slot& slot : _slots)
+        {
+            if(slot._module)
+            {
+                f(slot._ilid, slot._module);
+            }
+        }
+    }
+}
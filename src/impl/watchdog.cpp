@@ -0,0 +1,304 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "watchdog.hpp"
+#include <dci/poll/awaker.hpp>
+#include <dci/logger.hpp>
+#include "../placement.hpp"
+#include <boost/stacktrace.hpp>
+#include <boost/core/demangle.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+#ifndef _WIN32
+#   include <dlfcn.h>
+#   include <pthread.h>
+#   include <signal.h>
+#   include <cerrno>
+#   include <cstring>
+#   define DCI_HOST_WATCHDOG_CAPTURE 1
+#endif
+
+namespace dci::host::impl
+{
+    namespace fs = std::filesystem;
+
+#ifdef DCI_HOST_WATCHDOG_CAPTURE
+    namespace
+    {
+        constexpr std::size_t depthMax = 64;
+
+        //заполняется обработчиком в потоке цикла
+        boost::stacktrace::frame::native_frame_ptr_t    captured[depthMax];
+        std::atomic<std::size_t>                        capturedDepth {};
+        std::atomic<bool>                               capturedReady {};
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        int captureSignal()
+        {
+#ifdef SIGRTMIN
+            return SIGRTMIN + 1;
+#else
+            return SIGURG;
+#endif
+        }
+
+        /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+        void onCapture(int, siginfo_t*, void*)
+        {
+            int savedErrno = errno;
+            capturedDepth.store(boost::stacktrace::safe_dump_to(1, captured, sizeof(captured)), std::memory_order_relaxed);
+            capturedReady.store(true, std::memory_order_release);
+            errno = savedErrno;
+        }
+    }
+#endif
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Watchdog::Watchdog()
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Watchdog::~Watchdog()
+    {
+        stop();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Watchdog::thresholds(std::chrono::milliseconds stall, std::chrono::milliseconds abort)
+    {
+        _stall = stall;
+        _abort = abort;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Watchdog::enabled() const
+    {
+        return _stall.count() > 0 || _abort.count() > 0;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Watchdog::binaries(std::vector<Binary>&& binaries)
+    {
+        std::lock_guard l{_binariesMtx};
+        _binaries = std::move(binaries);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Watchdog::start()
+    {
+        if(_thread.joinable() || !enabled())
+        {
+            return;
+        }
+
+#ifdef DCI_HOST_WATCHDOG_CAPTURE
+        _loopThread = pthread_self();
+
+        struct sigaction sa {};
+        sa.sa_sigaction = &onCapture;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(captureSignal(), &sa, nullptr);
+
+        //первый вызов раскрутки подгружает libgcc_s, в обработчике этого делать нельзя
+        boost::stacktrace::safe_dump_to(captured, sizeof(captured));
+#endif
+
+        _awaker = std::make_unique<poll::Awaker>(false);
+        _awaker->woken() += _sol * [this]
+        {
+            beat();
+        };
+
+        _stopping = false;
+        _thread = std::thread{[this]
+        {
+            //поток создается после привязки цикла к процессорам и не должен ее наследовать
+            std::string error;
+            if(!unpinCurrentThread(error))
+            {
+                LOGW("watchdog: "<<error);
+            }
+
+            worker();
+        }};
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Watchdog::stop()
+    {
+        if(!_thread.joinable())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard l{_mtx};
+            _stopping = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+
+        _sol.flush();
+        _awaker.reset();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Watchdog::beat()
+    {
+        _beats.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Watchdog::worker()
+    {
+        using Clock = std::chrono::steady_clock;
+
+        std::chrono::milliseconds first = _stall.count() > 0 ? _stall : _abort;
+        std::chrono::milliseconds period = std::max(std::chrono::milliseconds{1}, first / 4);
+        constexpr std::chrono::seconds logInterval{10};
+
+        std::uint64_t lastBeats = _beats.load();
+        Clock::time_point lastBeatMoment = Clock::now();
+
+        bool reported = false;
+        Clock::time_point lastLog {};
+        std::size_t suppressed {};
+
+        std::unique_lock l{_mtx};
+        while(!_cv.wait_for(l, period, [this]{return _stopping;}))
+        {
+            _awaker->wakeup();
+
+            Clock::time_point now = Clock::now();
+            std::uint64_t beats = _beats.load(std::memory_order_relaxed);
+            if(beats != lastBeats)
+            {
+                if(reported)
+                {
+                    LOGI("watchdog: loop resumed after "<<std::chrono::duration_cast<std::chrono::milliseconds>(now - lastBeatMoment).count()<<"ms");
+                }
+
+                lastBeats = beats;
+                lastBeatMoment = now;
+                reported = false;
+                continue;
+            }
+
+            auto stalled = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastBeatMoment);
+
+            if(_stall.count() > 0 && stalled >= _stall && !reported)
+            {
+                reported = true;
+
+                if(now - lastLog < logInterval && lastLog != Clock::time_point{})
+                {
+                    ++suppressed;
+                }
+                else
+                {
+                    lastLog = now;
+
+                    l.unlock();
+                    std::string module, daemons;
+                    std::string stack = captureLoopStack(module, daemons);
+                    l.lock();
+
+                    LOGW("watchdog: loop stalled for "<<stalled.count()<<"ms"
+                         <<(module.empty() ? std::string{} : ", in module \""+module+"\"")
+                         <<(daemons.empty() ? std::string{} : ", daemons "+daemons)
+                         <<(suppressed ? ", "+std::to_string(suppressed)+" stalls not reported" : std::string{})
+                         <<(stack.empty() ? std::string{} : "\n"+stack));
+                    suppressed = 0;
+                }
+            }
+
+            if(_abort.count() > 0 && stalled >= _abort)
+            {
+                LOGF("watchdog: loop stalled for "<<stalled.count()<<"ms, abort");
+#ifdef DCI_HOST_WATCHDOG_CAPTURE
+                pthread_kill(_loopThread, SIGABRT);
+#else
+                std::abort();
+#endif
+                return;
+            }
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::string Watchdog::captureLoopStack(std::string& module, std::string& daemons)
+    {
+#ifdef DCI_HOST_WATCHDOG_CAPTURE
+        capturedReady = false;
+        if(pthread_kill(_loopThread, captureSignal()))
+        {
+            return {};
+        }
+
+        for(int i{}; i<100 && !capturedReady.load(std::memory_order_acquire); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+
+        if(!capturedReady.load(std::memory_order_acquire))
+        {
+            return "stack not captured";
+        }
+
+        std::error_code ec;
+        std::lock_guard bl{_binariesMtx};
+
+        std::ostringstream out;
+        std::size_t depth = std::min(capturedDepth.load(), depthMax);
+        for(std::size_t i{}; i<depth && captured[i]; ++i)
+        {
+            out << "    #" << i << ' ' << captured[i];
+
+            Dl_info info {};
+            if(dladdr(captured[i], &info))
+            {
+                if(info.dli_sname)
+                {
+                    out << ' ' << boost::core::demangle(info.dli_sname);
+                }
+
+                if(info.dli_fname)
+                {
+                    fs::path object = fs::weakly_canonical(info.dli_fname, ec);
+                    out << " in " << object.filename().string();
+
+                    //ближайший к вершине кадр из главного бинарника модуля
+                    if(module.empty() && !ec)
+                    {
+                        auto binary = std::find_if(_binaries.begin(), _binaries.end(), [&](const Binary& b)
+                        {
+                            return b._path == object.native();
+                        });
+
+                        if(_binaries.end() != binary)
+                        {
+                            module = binary->_module;
+                            daemons = binary->_daemons;
+                        }
+                    }
+                }
+            }
+            out << '\n';
+        }
+
+        return out.str();
+#else
+        (void)module;
+        (void)daemons;
+        return {};
+#endif
+    }
+}
@@ -0,0 +1,85 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <dci/sbs/owner.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#   include <pthread.h>
+#endif
+
+namespace dci::poll
+{
+    class Awaker;
+}
+
+namespace dci::host::impl
+{
+    //сторожевой поток: периодически будит цикл и ждет пульса; если цикл не отвечает дольше порога -
+    //снимает стек потока цикла направленным сигналом, определяет модуль и его демоны и пишет в лог с ограничением частоты;
+    //после порога аварийной остановки посылает потоку цикла SIGABRT, дальше работает обработчик аварии
+    class Watchdog
+    {
+        Watchdog(const Watchdog&) = delete;
+        void operator=(const Watchdog&) = delete;
+
+    public:
+        Watchdog();
+        ~Watchdog();
+
+        void thresholds(std::chrono::milliseconds stall, std::chrono::milliseconds abort);//0 - выключено
+        bool enabled() const;
+
+        //для отчета о зависании: главные бинарники модулей (канонические пути), имена из манифестов и демоны модулей
+        struct Binary
+        {
+            std::string _path;
+            std::string _module;
+            std::string _daemons;
+        };
+        void binaries(std::vector<Binary>&& binaries);
+
+        //из потока цикла, он и наблюдается
+        void start();
+        void stop();
+
+        void beat();
+
+    private:
+        void worker();
+        std::string captureLoopStack(std::string& module, std::string& daemons);
+
+    private:
+        std::chrono::milliseconds       _stall {};
+        std::chrono::milliseconds       _abort {};
+
+        std::atomic<std::uint64_t>      _beats {};
+        std::unique_ptr<poll::Awaker>   _awaker;
+        sbs::Owner                      _sol;
+
+        std::mutex                      _mtx;
+        std::condition_variable         _cv;
+        bool                            _stopping {};
+        std::thread                     _thread;
+
+        std::mutex                      _binariesMtx;
+        std::vector<Binary>             _binaries;
+#ifndef _WIN32
+        pthread_t                       _loopThread {};
+#endif
+    };
+}
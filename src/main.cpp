@@ -12,7 +12,6 @@
 #include <dci/host.hpp>
 #include <dci/cmt.hpp>
 #include <dci/utils/atScopeExit.hpp>
-#include <dci/utils/b2h.hpp>
 #include <dci/exception.hpp>
 #include <dci/aup/instance/setup.hpp>
 #include <dci/aup/instance/io.hpp>
@@ -24,19 +23,25 @@
 #include <dci/integration/info.hpp>
 #include <filesystem>
 #include <boost/program_options.hpp>
+#include <algorithm>
+#include <atomic>
 #include <csignal>
-
-#include <boost/stacktrace.hpp>
-
-#if __has_include(<link.h>)
-#   include <link.h>
+#include <thread>
+
+#include "cmd/crashDump.hpp"
+#include "cmd/profiler.hpp"
+#include "cmd/symbolize.hpp"
+
+#ifndef _WIN32
+#   include <sys/select.h>
+#   include <sys/wait.h>
+#   include <unistd.h>
+#   include <map>
+#   include <optional>
 #endif
 
 #ifdef _WIN32
 #   include <windows.h>
-#   include <psapi.h>
-#   include <dbghelp.h>
-#   include <winnt.h>
 #endif
 
 namespace fs = std::filesystem;
@@ -66,204 +71,22 @@ namespace
     std::size_t         stopsCount {};
     bool                stopInitiated {};
     dci::poll::Awaker*  pollAwaker{};
-}
-
-/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-static void dumpStacks()
-{
-    //TODO:  async-safe
-    std::cout << "dumpStack to /tmp/dump2" << std::endl;
-    std::ofstream out{"/tmp/dump2"};
-
-    if(!out)
-    {
-        return;
-    }
-
-    out << "srcBranch           : " << dci::integration::info::srcBranch() << '\n';
-    out << "srcRevision         : " << dci::integration::info::srcRevision() << '\n';
-    out << "platformOs          : " << dci::integration::info::platformOs() << '\n';
-    out << "platformArch        : " << dci::integration::info::platformArch() << '\n';
-    out << "compiler            : " << dci::integration::info::compiler() << '\n';
-    out << "compilerVersion     : " << dci::integration::info::compilerVersion() << '\n';
-    out << "compilerOptimization: " << dci::integration::info::compilerOptimization() << '\n';
-    out << "provider            : " << dci::integration::info::provider() << '\n';
-
-#ifdef _WIN32
-    out << "modules" << std::endl;
-    std::vector<HMODULE> hMods;
-    hMods.resize(32);
-    DWORD cbNeeded = 0;
-    HANDLE hProcess = GetCurrentProcess();
-    while(EnumProcessModules(hProcess, hMods.data(), hMods.size()*sizeof(HMODULE), &cbNeeded) && cbNeeded > hMods.size()*sizeof(HMODULE))
-    {
-        hMods.resize(cbNeeded/sizeof(HMODULE));
-    }
 
-    for(DWORD i{}; i < (cbNeeded/sizeof(HMODULE)); i++)
+    //подготовка обновления: модули проверяются и прогреваются до остановки работающего хоста
+    enum class AupStaging
     {
-        fs::path modName;
-        WCHAR szModName[MAX_PATH];
-
-        if(GetModuleFileNameExW(hProcess, hMods[i], szModName, sizeof(szModName) / sizeof(WCHAR)))
-        {
-            modName = fs::path{szModName};
-        }
-
-        ///////////////////////////////////////////////
-        out << reinterpret_cast<const void*>(hMods[i]) << " " << modName.string();
-
-        bool idFetched = false;
-        if(!idFetched)
-        {
-            const char *image = (const char *)hMods[i];
-            IMAGE_DOS_HEADER* dosHeader = (IMAGE_DOS_HEADER*)image;
-            IMAGE_NT_HEADERS* ntHeaders = (IMAGE_NT_HEADERS*)&image[dosHeader->e_lfanew];
-            for(WORD sectionIndex{}; sectionIndex < ntHeaders->FileHeader.NumberOfSections; ++sectionIndex)
-            {
-                IMAGE_SECTION_HEADER* section = (IMAGE_SECTION_HEADER*)&image[dosHeader->e_lfanew + sizeof(IMAGE_NT_HEADERS) + sectionIndex*sizeof(IMAGE_SECTION_HEADER)];
-                if(section->Misc.VirtualSize < 48)
-                {
-                    continue;
-                }
-
-                if(strncmp((const char*)&section->Name[0], ".buildid", IMAGE_SIZEOF_SHORT_NAME))
-                {
-                    continue;
-                }
-
-                const dci::uint32 type = *(const dci::uint32*)&image[section->VirtualAddress + 28];
-                if(0x53445352 != type)//RSDS
-                {
-                    continue;
-                }
-
-                const dci::byte* hash = (const dci::byte*)&image[section->VirtualAddress + 32];
-                out << " gnu:";
-                out << dci::utils::b2h(hash+0, 4, dci::utils::HexEndian::big);
-                out << dci::utils::b2h(hash+4, 2, dci::utils::HexEndian::big);
-                out << dci::utils::b2h(hash+6, 2, dci::utils::HexEndian::big);
-                out << dci::utils::b2h(hash+8, 8, dci::utils::HexEndian::middle);
-                idFetched = true;
-                break;
-            }
-        }
-
-        if(!idFetched)
-        {
-            SYMSRV_INDEX_INFOW info{};
-            info.sizeofstruct = sizeof(info);
-            if(SymSrvGetFileIndexInfoW(szModName, &info, 0))
-            {
-                out << " ms:";
-                char buf[64];
-                std::sprintf(buf, "%lx%lx", info.timestamp, info.size);
-                out << buf;
-                idFetched = true;
-            }
-        }
-        out << std::endl;
-    }
-#else
-    out << "shared objects" << std::endl;
-    {
-        dl_iterate_phdr([](struct dl_phdr_info *info, size_t /*size*/, void *data) -> int
-        {
-            ///////////////////////////////////////////////
-            const char *soName = info->dlpi_name;
-            char exe[PATH_MAX];
-            if(!soName || !soName[0])
-            {
-                ssize_t ret = readlink("/proc/self/exe", exe, sizeof(exe)-1);
-                if(ret >= 0)
-                {
-                    exe[ret] = 0;
-                    soName = exe;
-                }
-            }
-
-            ///////////////////////////////////////////////
-            struct BuildIdNote
-            {
-                ElfW(Nhdr)  _nhdr;
-                char        _name[4];
-                uint8_t     _data[1];
-            };
-            BuildIdNote* buildIdNote{};
-
-            for(std::size_t i{}; i < info->dlpi_phnum; ++i)
-            {
-                if(PT_NOTE != info->dlpi_phdr[i].p_type)
-                {
-                    continue;
-                }
-
-                BuildIdNote* note = (BuildIdNote*)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
-                std::size_t len = info->dlpi_phdr[i].p_filesz;
-
-                while(len >= sizeof(BuildIdNote))
-                {
-                    if (note->_nhdr.n_type == NT_GNU_BUILD_ID &&
-                        note->_nhdr.n_descsz != 0 &&
-                        note->_nhdr.n_namesz == 4 &&
-                        memcmp(note->_name, "GNU", 4) == 0)
-                    {
-                        buildIdNote = note;
-                        break;
-                    }
-
-                    auto align = [](std::size_t val, std::size_t align)
-                    {
-                        return (((val) + (align) - 1) & ~((align) - 1));
-                    };
-
-                    std::size_t offset = sizeof(ElfW(Nhdr)) +
-                                    align(note->_nhdr.n_namesz, 4) +
-                                    align(note->_nhdr.n_descsz, 4);
-                    note = (BuildIdNote*)((char*)note + offset);
-                    len -= offset;
-                }
-            }
-
-            ///////////////////////////////////////////////
-            std::ofstream& out = *static_cast<std::ofstream*>(data);
-            out << reinterpret_cast<const void*>(info->dlpi_addr) << " " << soName;
-            if(buildIdNote)
-            {
-                out << " " << dci::utils::b2h(buildIdNote->_data, buildIdNote->_nhdr.n_descsz, dci::utils::HexEndian::middle);
-            }
-            out << std::endl;
-            return 0;
-        }, &out);
-    }
-#endif
-
-    dci::cmt::enumerateFibers([](dci::cmt::task::State state, void *data)
-    {
-        std::ofstream& out = *static_cast<std::ofstream*>(data);
-
-        out << "ctx[";
-        switch(state)
-        {
-        case dci::cmt::task::State::null : out << "null" ; break;
-        case dci::cmt::task::State::ready: out << "ready"; break;
-        case dci::cmt::task::State::work : out << "work" ; break;
-        case dci::cmt::task::State::hold : out << "hold" ; break;
-        default: out << "unknown"; break;
-        }
-        out << "]";
-
-        boost::stacktrace::stacktrace st{};
-
-        for(const boost::stacktrace::frame& frame : st)
-        {
-            out << ' ' << frame.address();
-        }
-        out << '\n';
-
-    }, &out);
+        none,
+        inProgress,
+        ready,
+        failed,
+    };
+    std::atomic<AupStaging> aupStaging {AupStaging::none};
+    std::atomic<bool>       profilerToggle {};
+    std::thread             aupStagingThread;
 
-    out.close();
+    //момент начала остановки перед перезапуском, передается в новый процесс для замера простоя
+    constexpr const char*   restartBeginEnv = "DCI_HOST_RESTART_BEGIN";
+    std::chrono::system_clock::time_point restartBegin;
 }
 
 /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
@@ -281,7 +104,7 @@ static void signalHandler(int signum)
 #endif
         if(++stopsCount >= std::size_t{3} || !manager)
         {
-            dumpStacks();
+            dci::host::crashDump::write(signum);
 #ifdef _WIN32
             ::TerminateProcess(GetCurrentProcess(), EXIT_FAILURE);
 #else
@@ -297,11 +120,20 @@ static void signalHandler(int signum)
 
 #ifdef SIGUSR1
     case SIGUSR1:
-        dumpStacks();
+        dci::host::crashDump::write(signum);
+        break;
+#endif
+#ifdef SIGUSR2
+    case SIGUSR2:
+        profilerToggle = true;
+        if(pollAwaker)
+        {
+            pollAwaker->wakeup();
+        }
         break;
 #endif
     default:
-        dumpStacks();
+        dci::host::crashDump::write(signum);
 #ifdef _WIN32
         ::TerminateProcess(GetCurrentProcess(), EXIT_FAILURE);
 #else
@@ -315,6 +147,16 @@ static int restartAfterAupApplied(std::vector<std::string> argv)
 {
     LOGI("restart because of aup");
 
+    //зарегистрированные демонами дескрипторы переживают execv
+    dci::host::handoff::prepareExec();
+
+#ifndef _WIN32
+    if(std::chrono::system_clock::time_point{} != restartBegin)
+    {
+        setenv(restartBeginEnv, std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(restartBegin.time_since_epoch()).count()).c_str(), 1);
+    }
+#endif
+
     argv[0] = executablePath.string();
 
     std::vector<char*> c_argv;
@@ -328,14 +170,295 @@ static int restartAfterAupApplied(std::vector<std::string> argv)
 
     if(execv(executablePath.string().c_str(), c_argv.data()))
     {
-        LOGF("unable to restart: "<<strerror(errno));
+        int err = errno;
+
+        //процесс продолжает завершаться сам, дескрипторы не должны утечь в его дочерние
+        dci::host::handoff::execFailed();
+
+        LOGF("unable to restart: "<<strerror(err));
     }
 
     return EXIT_FAILURE;
 }
 
 /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
-bool printOutput(const po::variables_map& vars, const std::string& content);
+//в фоновом потоке, по готовности будит цикл
+static void stageAupUpdate()
+{
+    if(AupStaging::inProgress == aupStaging)
+    {
+        return;
+    }
+
+    if(aupStagingThread.joinable())
+    {
+        aupStagingThread.join();
+    }
+
+    aupStaging = AupStaging::inProgress;
+    //наследует привязку потока цикла (--cpus), сам только ждет дочерний процесс подготовки
+    aupStagingThread = std::thread{[]
+    {
+        bool ok = false;
+        const auto startMoment = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+        ok = true;
+#else
+        pid_t pid = fork();
+        if(!pid)
+        {
+            execl(executablePath.c_str(), executablePath.c_str(), "--verify-modules", static_cast<char*>(nullptr));
+            _exit(127);
+        }
+
+        if(0 < pid)
+        {
+            int status {};
+            while(0 > waitpid(pid, &status, 0) && EINTR == errno)
+            {
+            }
+
+            ok = WIFEXITED(status) && EXIT_SUCCESS == WEXITSTATUS(status);
+        }
+#endif
+
+        LOGI("aup staging: "<<(ok ? "verified" : "FAILED")<<" in "
+             <<std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startMoment).count()<<"ms");
+
+        aupStaging = ok ? AupStaging::ready : AupStaging::failed;
+        if(pollAwaker)
+        {
+            pollAwaker->wakeup();
+        }
+    }};
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+//-1 в дочернем процессе, он продолжает как обычный хост; иначе код завершения родителя
+static int superviseWorkers(std::size_t amount, std::size_t& workerIndex)
+{
+#ifdef _WIN32
+    (void)amount;
+    (void)workerIndex;
+    LOGW("workers mode is not supported on this platform, run single process");
+    return -1;
+#else
+    struct Worker
+    {
+        std::size_t                             _index;
+        std::chrono::steady_clock::time_point   _started;
+    };
+    std::map<pid_t, Worker> workers;
+
+    //перезапуск упавших с нарастающей паузой, после restartLimit падений подряд воркер больше не поднимается
+    constexpr std::size_t restartLimit = 8;
+    constexpr std::chrono::seconds stableUptime{30};
+    constexpr std::chrono::milliseconds maxRestartDelay{30000};
+
+    struct Restart
+    {
+        std::size_t                             _failures {};
+        bool                                    _pending = false;
+        std::chrono::steady_clock::time_point   _due {};
+    };
+    std::vector<Restart> restarts(amount);
+    bool abandoned = false;
+
+    //SIGCHLD и сигналы остановки заблокированы вне ожидания, pselect открывает их атомарно и ничего не теряется
+    sigset_t waitSet, oldMask, waitMask;
+    sigemptyset(&waitSet);
+    for(int signum : {SIGCHLD, SIGINT, SIGTERM
+#ifdef SIGQUIT
+         , SIGQUIT
+#endif
+#ifdef SIGTSTP
+         , SIGTSTP
+#endif
+        })
+    {
+        sigaddset(&waitSet, signum);
+    }
+
+    //при SIG_DFL сигнал SIGCHLD отбрасывается и не прерывает ожидание
+    struct sigaction chldAction{}, oldChldAction{};
+    chldAction.sa_handler = [](int){};
+    sigemptyset(&chldAction.sa_mask);
+    sigaction(SIGCHLD, &chldAction, &oldChldAction);
+    sigprocmask(SIG_BLOCK, &waitSet, &oldMask);
+
+    waitMask = oldMask;
+    for(int signum{1}; signum<NSIG; ++signum)
+    {
+        if(sigismember(&waitSet, signum))
+        {
+            sigdelset(&waitMask, signum);
+        }
+    }
+
+    auto restoreSignals = [&]
+    {
+        sigprocmask(SIG_SETMASK, &oldMask, nullptr);
+        sigaction(SIGCHLD, &oldChldAction, nullptr);
+    };
+
+    auto fail = [&](std::size_t index)
+    {
+        Restart& restart = restarts[index];
+        if(++restart._failures > restartLimit)
+        {
+            LOGE("worker "<<index<<": "<<restartLimit<<" failures in a row, give up");
+            abandoned = true;
+            return;
+        }
+
+        std::chrono::milliseconds delay = std::min(maxRestartDelay, std::chrono::milliseconds{100} * (std::int64_t{1} << (restart._failures-1)));
+        restart._pending = true;
+        restart._due = std::chrono::steady_clock::now() + delay;
+        LOGI("worker "<<index<<": restart in "<<delay.count()<<"ms");
+    };
+
+    //true - мы в дочернем
+    auto spawn = [&](std::size_t index)
+    {
+        pid_t pid = fork();
+        if(pid < 0)
+        {
+            LOGE("worker "<<index<<": unable to fork: "<<strerror(errno));
+            fail(index);
+            return false;
+        }
+
+        if(!pid)
+        {
+            restoreSignals();
+            workerIndex = index;
+            return true;
+        }
+
+        workers.emplace(pid, Worker{index, std::chrono::steady_clock::now()});
+        LOGI("worker "<<index<<" started, pid "<<pid);
+        return false;
+    };
+
+    auto restartsPending = [&]
+    {
+        return std::any_of(restarts.begin(), restarts.end(), [](const Restart& r){return r._pending;});
+    };
+
+    for(std::size_t i{}; i<amount; ++i)
+    {
+        if(spawn(i))
+        {
+            return -1;
+        }
+    }
+
+    bool stopForwarded = false;
+
+    while(!workers.empty() || restartsPending())
+    {
+        if(stopsCount && !stopForwarded)
+        {
+            stopForwarded = true;
+            LOGI("stop workers");
+            for(const auto&[pid, worker] : workers)
+            {
+                kill(pid, SIGTERM);
+            }
+
+            for(Restart& restart : restarts)
+            {
+                restart._pending = false;
+            }
+        }
+
+        for(;;)
+        {
+            int status {};
+            pid_t pid = waitpid(-1, &status, WNOHANG);
+            if(pid <= 0)
+            {
+                break;
+            }
+
+            auto iter = workers.find(pid);
+            if(workers.end() == iter)
+            {
+                continue;
+            }
+
+            Worker worker = iter->second;
+            workers.erase(iter);
+
+            const bool crashed = WIFSIGNALED(status) || (WIFEXITED(status) && EXIT_SUCCESS != WEXITSTATUS(status));
+            if(WIFSIGNALED(status))
+            {
+                LOGW("worker "<<worker._index<<", pid "<<pid<<": killed by signal "<<WTERMSIG(status));
+            }
+            else
+            {
+                LOGI("worker "<<worker._index<<", pid "<<pid<<": exited with "<<WEXITSTATUS(status));
+            }
+
+            if(!crashed || stopsCount)
+            {
+                continue;
+            }
+
+            //долго проработавший считается здоровым, счет падений подряд начинается заново
+            if(std::chrono::steady_clock::now() - worker._started >= stableUptime)
+            {
+                restarts[worker._index]._failures = 0;
+            }
+
+            fail(worker._index);
+        }
+
+        std::optional<std::chrono::steady_clock::time_point> nearest;
+        for(std::size_t i{}; i<restarts.size() && !stopsCount; ++i)
+        {
+            if(restarts[i]._pending && restarts[i]._due <= std::chrono::steady_clock::now())
+            {
+                restarts[i]._pending = false;
+                if(spawn(i))
+                {
+                    return -1;
+                }
+            }
+
+            if(restarts[i]._pending && (!nearest || restarts[i]._due < *nearest))
+            {
+                nearest = restarts[i]._due;
+            }
+        }
+
+        if(workers.empty() && !restartsPending())
+        {
+            break;
+        }
+
+        timespec timeout {};
+        if(nearest)
+        {
+            auto left = std::max(std::chrono::steady_clock::duration{}, *nearest - std::chrono::steady_clock::now());
+            auto secs = std::chrono::duration_cast<std::chrono::seconds>(left);
+            timeout.tv_sec = static_cast<time_t>(secs.count());
+            timeout.tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(left - secs).count());
+        }
+
+        pselect(0, nullptr, nullptr, nullptr, nearest ? &timeout : nullptr, &waitMask);
+    }
+
+    restoreSignals();
+
+    return abandoned ? EXIT_FAILURE : EXIT_SUCCESS;
+#endif
+}
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+bool printOutput(const std::string& outfile, const std::string& content, bool& changed);
+bool readGenmanifestJobs(const std::string& listFile, std::vector<std::pair<std::string, std::string>>& jobs);
 
 /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
 static std::chrono::system_clock::time_point timeProvider4Logging()
@@ -380,9 +503,35 @@ int main(int c_argc, char* c_argv[])
 #endif
 #ifdef SIGUSR1
     signal(SIGUSR1, signalHandler);
+#endif
+#ifdef SIGUSR2
+    signal(SIGUSR2, signalHandler);
 #endif
     dci::mm::setupPanicHandler(signalHandler);
 
+    //буферы и альтернативный стек для снимка при аварии, обработчики фатальных сигналов переводятся на этот стек
+    dci::host::crashDump::setup(fs::temp_directory_path().string());
+    for(int signum : {SIGSEGV, SIGILL, SIGFPE, SIGABRT
+#ifdef SIGBUS
+                      , SIGBUS
+#endif
+                     })
+    {
+        dci::host::crashDump::useAltStack(signum);
+    }
+
+    //дескрипторы от предыдущего процесса, если это перезапуск
+    dci::host::handoff::adopt();
+
+    std::chrono::system_clock::time_point previousRestartBegin;
+    if(const char* env = std::getenv(restartBeginEnv))
+    {
+        previousRestartBegin = std::chrono::system_clock::time_point{std::chrono::microseconds{std::atoll(env)}};
+#ifndef _WIN32
+        unsetenv(restartBeginEnv);
+#endif
+    }
+
     //formalize args
     const std::vector<std::string> argv = [&]()
     {
@@ -404,13 +553,13 @@ int main(int c_argc, char* c_argv[])
             ("version", "print version info")
             (
                 "genmanifest",
-                po::value<std::string>(),
-                "generate manifest file for module shared library"
+                po::value<std::vector<std::string>>()->multitoken(),
+                "generate manifest file for module shared library(ies), @file for list of \"binary<TAB>outfile\" lines"
             )
             (
                 "outfile",
-                po::value<std::string>(),
-                "output file name for genmanifest"
+                po::value<std::vector<std::string>>()->multitoken(),
+                "output file name(s) for genmanifest, pairwise with binaries"
             )
             (
                 "module",
@@ -430,13 +579,97 @@ int main(int c_argc, char* c_argv[])
             (
                 "run",
                 po::value<std::vector<std::string>>()->multitoken(),
-                "run daemon"
+                "run daemon; built-in: host-metrics listen=unix:<path>|tcp:<port>, Prometheus text metrics of the host"
             )
             (
                 "runN",
                 po::value<std::vector<std::string>>()->multitoken(),
                 "run daemon multiple times"
             )
+            (
+                "load-threads",
+                po::value<std::size_t>()->default_value(0),
+                "threads for parallel reading of module binaries before dlopen in the main loop, 0 for none"
+            )
+            (
+                "offload-threads",
+                po::value<std::size_t>()->default_value(0),
+                "helper threads kept for the whole run, modules offload blocking work to them (Manager::runOffloaded); the event loop itself stays single; 0 - none"
+            )
+            (
+                "startup-report",
+                po::value<std::string>(),
+                "write per-module startup timings as json to the file specified"
+            )
+            (
+                "workers",
+                po::value<std::size_t>()->default_value(0),
+                "load modules once, then fork worker processes sharing the loaded pages; the parent supervises them. 0 - single process"
+            )
+            (
+                "verify-modules",
+                "load every module changed since the host start and check its manifest, then exit; used by aup staging"
+            )
+            (
+                "symbolize",
+                po::value<std::string>(),
+                "symbolize a crash dump file, print folded fiber stacks grouped by state, then exit"
+            )
+            (
+                "profile",
+                po::value<std::size_t>()->default_value(0),
+                "sample the loop thread with given frequency, Hz; 0 - off, SIGUSR2 toggles at runtime"
+            )
+            (
+                "profile-dir",
+                po::value<std::string>(),
+                "directory for folded stacks of the profiler, system temp directory by default"
+            )
+            (
+                "crash-dir",
+                po::value<std::string>(),
+                "directory for crash dumps, system temp directory by default"
+            )
+            (
+                "fiber-stats-interval",
+                po::value<std::size_t>()->default_value(1000),
+                "milliseconds between fiber state samples, 0 - no sampling"
+            )
+            (
+                "watchdog-stall",
+                po::value<std::size_t>()->default_value(0),
+                "milliseconds without a loop turn before the loop thread stack is logged, 0 - off"
+            )
+            (
+                "watchdog-abort",
+                po::value<std::size_t>()->default_value(0),
+                "milliseconds without a loop turn before the process is aborted with a crash dump, 0 - off"
+            )
+            (
+                "drain-timeout",
+                po::value<std::size_t>()->default_value(5000),
+                "milliseconds for modules to finish work held by stop locks on shutdown, 0 - no waiting"
+            )
+            (
+                "cpus",
+                po::value<std::string>()->default_value(""),
+                "pin the main loop thread to cpus, list like 0-3,8"
+            )
+            (
+                "helper-cpus",
+                po::value<std::string>()->default_value(""),
+                "pin helper threads (see --offload-threads, --load-threads) to cpus"
+            )
+            (
+                "worker-cpus",
+                po::value<std::vector<std::string>>()->multitoken(),
+                "per worker cpus for --workers mode, one list per worker, reused cyclically; overrides --cpus"
+            )
+            (
+                "numa-node",
+                po::value<int>()->default_value(-1),
+                "bind memory of the host to the numa node, -1 - no binding"
+            )
             (
                 "aup",
                 po::value<std::vector<std::string>>()->multitoken()->implicit_value({"@../etc/aup.conf"}, "@../etc/aup.conf"),
@@ -458,6 +691,11 @@ int main(int c_argc, char* c_argv[])
         });
     po::notify(vars);
 
+    if(vars.count("crash-dir"))
+    {
+        dci::host::crashDump::directory(vars["crash-dir"].as<std::string>());
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     if(vars.empty() || vars.count("version"))
     {
@@ -472,23 +710,94 @@ int main(int c_argc, char* c_argv[])
         return EXIT_SUCCESS;
     }
 
+    ////////////////////////////////////////////////////////////////////////////////
+    if(vars.count("verify-modules"))
+    {
+        return Manager::verifyModules() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    if(vars.count("symbolize"))
+    {
+        return dci::host::symbolize(vars["symbolize"].as<std::string>(), std::cout);
+    }
+
+    if(vars.count("profile-dir"))
+    {
+        dci::host::profiler::directory(vars["profile-dir"].as<std::string>());
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     if(vars.count("genmanifest"))
     {
-        std::string content = tryCatch("genmanifest",
-            [&]{
-                return Manager::moduleManifest(vars["genmanifest"].as<std::string>()).toConf();
-            },
-            []{
-                return std::string();
-            });
+        std::vector<std::pair<std::string, std::string>> jobs;
 
-        if(content.empty())
         {
-            return EXIT_FAILURE;
+            std::vector<std::string> binaries = vars["genmanifest"].as<std::vector<std::string>>();
+            std::vector<std::string> outfiles;
+            if(vars.count("outfile"))
+            {
+                outfiles = vars["outfile"].as<std::vector<std::string>>();
+            }
+
+            std::size_t outfileIndex{};
+            for(const std::string& binary : binaries)
+            {
+                if(binary.starts_with('@'))
+                {
+                    if(!readGenmanifestJobs(binary.substr(1), jobs))
+                    {
+                        return EXIT_FAILURE;
+                    }
+                    continue;
+                }
+
+                jobs.emplace_back(binary, outfileIndex < outfiles.size() ? outfiles[outfileIndex] : std::string{});
+                ++outfileIndex;
+            }
+
+            if(outfileIndex < outfiles.size())
+            {
+                LOGE("genmanifest: more outfiles than binaries");
+                return EXIT_FAILURE;
+            }
         }
 
-        return printOutput(vars, content) ? EXIT_SUCCESS : EXIT_FAILURE;
+        bool ok = true;
+        std::size_t written{};
+        for(const auto&[binary, outfile] : jobs)
+        {
+            std::string content = tryCatch("genmanifest",
+                [&]{
+                    return Manager::moduleManifest(binary).toConf();
+                },
+                []{
+                    return std::string();
+                });
+
+            if(content.empty())
+            {
+                LOGE("genmanifest: failed for "<<binary);
+                ok = false;
+                continue;
+            }
+
+            bool changed{};
+            if(!printOutput(outfile, content, changed))
+            {
+                ok = false;
+                continue;
+            }
+
+            written += changed ? 1 : 0;
+        }
+
+        if(jobs.size() > 1)
+        {
+            LOGI("genmanifest: "<<jobs.size()<<" manifests, "<<written<<" written");
+        }
+
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
     if(stopsCount)
@@ -594,10 +903,14 @@ int main(int c_argc, char* c_argv[])
                         {
                             LOGI("target is updated by aup");
 
-                            aupApplied = true;
                             if(manager)
                             {
-                                manager->stop();
+                                //остановка только после проверки новых бинарников, см. pollAwaker
+                                stageAupUpdate();
+                            }
+                            else
+                            {
+                                aupApplied = true;
                             }
                         }
                         else if(dci::aup::applier::rCorruptedCatalog & res ||
@@ -661,6 +974,60 @@ int main(int c_argc, char* c_argv[])
             delete std::exchange(manager, nullptr);
         }};
 
+        manager->loadThreads(vars["load-threads"].as<std::size_t>());
+        manager->offloadThreads(vars["offload-threads"].as<std::size_t>());
+        manager->drainTimeout(std::chrono::milliseconds{vars["drain-timeout"].as<std::size_t>()});
+        manager->watchdog(
+                    std::chrono::milliseconds{vars["watchdog-stall"].as<std::size_t>()},
+                    std::chrono::milliseconds{vars["watchdog-abort"].as<std::size_t>()});
+        manager->fiberStatsInterval(std::chrono::milliseconds{vars["fiber-stats-interval"].as<std::size_t>()});
+
+        std::string loopCpus = vars["cpus"].as<std::string>();
+
+        if(std::size_t workers = vars["workers"].as<std::size_t>())
+        {
+            if(TestStage::null != testStage || !argAup.empty())
+            {
+                LOGW("workers mode is not combinable with tests and aup, run single process");
+            }
+            else
+            {
+                if(!manager->preload())
+                {
+                    LOGE("preload failed");
+                    return EXIT_FAILURE;
+                }
+
+                std::size_t workerIndex {};
+                int res = superviseWorkers(workers, workerIndex);
+                if(res >= 0)
+                {
+                    return res;
+                }
+
+                //переданные предыдущим процессом дескрипторы унаследованы всеми воркерами, забирает их только первый;
+                //родитель свои копии держит для перезапуска первого
+                if(workerIndex)
+                {
+                    dci::host::handoff::dropAdopted();
+                }
+
+                if(vars.count("worker-cpus"))
+                {
+                    const std::vector<std::string>& workerCpus = vars["worker-cpus"].as<std::vector<std::string>>();
+                    if(!workerCpus.empty())
+                    {
+                        loopCpus = workerCpus[workerIndex % workerCpus.size()];
+                    }
+                }
+            }
+        }
+
+        if(!manager->placement(loopCpus, vars["helper-cpus"].as<std::string>(), vars["numa-node"].as<int>()))
+        {
+            return EXIT_FAILURE;
+        }
+
         dci::sbs::Owner testRunnerOwner;
         auto testRunner = [&]()
         {
@@ -694,6 +1061,44 @@ int main(int c_argc, char* c_argv[])
             modulesStarted.out() += testRunner;
         }
 
+        struct StartupReporter
+        {
+            std::string _jsonFile;
+            std::size_t _pendingRuns {};
+            bool        _runsIssued {};
+            bool        _reported {};
+            std::chrono::system_clock::time_point _restartBegin;
+
+            void runDone()
+            {
+                --_pendingRuns;
+                tryReport();
+            }
+
+            void tryReport()
+            {
+                if(_runsIssued && !_pendingRuns && !_reported && manager)
+                {
+                    _reported = true;
+                    dci::host::handoff::closeUnclaimed();
+                    manager->startupReport(_jsonFile);
+
+                    if(std::chrono::system_clock::time_point{} != _restartBegin)
+                    {
+                        auto downtime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - _restartBegin);
+                        manager->restartDowntime(downtime);
+                        LOGI("restart downtime: "<<std::chrono::duration_cast<std::chrono::milliseconds>(downtime).count()<<"ms");
+                    }
+                }
+            }
+        } startupReporter;
+        startupReporter._restartBegin = previousRestartBegin;
+
+        if(vars.count("startup-report"))
+        {
+            startupReporter._jsonFile = vars["startup-report"].as<std::string>();
+        }
+
         for(const std::vector<std::string>& argv : fetchMultitokenArgs("run"))
         {
             if(1 > argv.size())
@@ -702,14 +1107,16 @@ int main(int c_argc, char* c_argv[])
                 continue;
             }
 
-            modulesStarted.out() += [=]
+            modulesStarted.out() += [=,&startupReporter]
             {
-                manager->runDaemon(argv).then() += [=](auto in)
+                ++startupReporter._pendingRuns;
+                manager->runDaemon(argv).then() += [=,&startupReporter](auto in)
                 {
                     if(in.resolvedException())
                     {
                         LOGE("daemon run failed: "<<argv[0]<<", "<<dci::exception::toString(in.exception()));
                     }
+                    startupReporter.runDone();
                 };
             };
         }
@@ -722,18 +1129,35 @@ int main(int c_argc, char* c_argv[])
                 continue;
             }
 
-            modulesStarted.out() += [=]
+            modulesStarted.out() += [=,&startupReporter]
             {
-                manager->runDaemons(argv).then() += [=](auto in)
+                ++startupReporter._pendingRuns;
+                manager->runDaemons(argv).then() += [=,&startupReporter](auto in)
                 {
                     if(in.resolvedException())
                     {
                         LOGE("daemons run failed: "<<argv[0]<<" x "<<argv[1]<<", "<<dci::exception::toString(in.exception()));
                     }
+                    startupReporter.runDone();
                 };
             };
         }
 
+        //отчет после того как все --run/--runN отработали старт
+        modulesStarted.out() += [&]
+        {
+            dci::host::crashDump::refreshObjects();
+            startupReporter._runsIssued = true;
+            startupReporter.tryReport();
+        };
+
+        //снимок при аварии должен знать адреса перезагруженных модулей
+        dci::sbs::Owner binariesChangedOwner;
+        manager->binariesChanged() += binariesChangedOwner * []
+        {
+            dci::host::crashDump::refreshObjects();
+        };
+
         dci::sbs::Owner pollAwakerOwner;
         dci::poll::Awaker pollAwakerInstance{false};
         pollAwaker = &pollAwakerInstance;
@@ -741,6 +1165,25 @@ int main(int c_argc, char* c_argv[])
 
         pollAwaker->woken() += pollAwakerOwner * [&]
         {
+            if(profilerToggle.exchange(false))
+            {
+                dci::host::profiler::toggle();
+            }
+
+            //забирается только завершенный исход, inProgress не трогается: поток подготовки может записать исход в любой момент
+            AupStaging expected = AupStaging::ready;
+            if(aupStaging.compare_exchange_strong(expected, AupStaging::none))
+            {
+                aupApplied = true;
+                restartBegin = std::chrono::system_clock::now();
+                LOGI("stop manager for update");
+                manager->stop();
+            }
+            else if(expected = AupStaging::failed; aupStaging.compare_exchange_strong(expected, AupStaging::none))
+            {
+                LOGE("aup update is not verified, keep running current version");
+            }
+
             if(stopsCount)
             {
                 if(!stopInitiated)
@@ -758,6 +1201,12 @@ int main(int c_argc, char* c_argv[])
 
         dci::poll::started() += [&]
         {
+            if(std::size_t hz = vars["profile"].as<std::size_t>())
+            {
+                dci::host::profiler::frequency(hz);
+                dci::host::profiler::start();
+            }
+
             std::vector<std::string> modules = vars["module"].as<std::vector<std::string>>();
             std::set<std::string> modulesSet{std::make_move_iterator(modules.begin()), std::make_move_iterator(modules.end())};
 
@@ -784,6 +1233,13 @@ int main(int c_argc, char* c_argv[])
                 LOGI("manager failed");
                 processResultCode = EXIT_FAILURE;
             });
+
+        dci::host::profiler::stop();
+
+        if(aupStagingThread.joinable())
+        {
+            aupStagingThread.join();
+        }
     }
 
     if(stopsCount)
@@ -800,14 +1256,30 @@ int main(int c_argc, char* c_argv[])
     return processResultCode;
 }
 
-bool printOutput(const po::variables_map& vars, const std::string& content)
+bool printOutput(const std::string& outfile, const std::string& content, bool& changed)
 {
-    if(vars.count("outfile"))
+    changed = true;
+
+    if(!outfile.empty())
     {
-        std::ofstream out(vars["outfile"].as<std::string>());
+        //неизменный результат не трогается, чтобы не будить зависимые цели сборки
+        {
+            std::ifstream in(outfile, std::ios::binary);
+            if(in)
+            {
+                std::string prev{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+                if(prev == content)
+                {
+                    changed = false;
+                    return true;
+                }
+            }
+        }
+
+        std::ofstream out(outfile);
         if(!out)
         {
-            std::cerr<<strerror(errno)<<std::endl;
+            std::cerr<<outfile<<": "<<strerror(errno)<<std::endl;
             return false;
         }
 
@@ -818,3 +1290,33 @@ bool printOutput(const po::variables_map& vars, const std::string& content)
     std::cout.write(content.data(), static_cast<std::streamsize>(content.size()));
     return true;
 }
+
+bool readGenmanifestJobs(const std::string& listFile, std::vector<std::pair<std::string, std::string>>& jobs)
+{
+    std::ifstream in(listFile);
+    if(!in)
+    {
+        std::cerr<<listFile<<": "<<strerror(errno)<<std::endl;
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty())
+        {
+            continue;
+        }
+
+        std::string::size_type tabPos = line.find('\t');
+        if(std::string::npos == tabPos)
+        {
+            std::cerr<<listFile<<": malformed line \""<<line<<"\""<<std::endl;
+            return false;
+        }
+
+        jobs.emplace_back(line.substr(0, tabPos), line.substr(tabPos+1));
+    }
+
+    return true;
+}
@@ -24,6 +24,12 @@ namespace dci::host
         return impl::Manager::moduleManifest(mainBinaryFullPath);
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::verifyModules()
+    {
+        return impl::Manager::verifyModules();
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     Manager::Manager()
         : himpl::FaceLayout<Manager, impl::Manager>()
@@ -47,6 +53,78 @@ namespace dci::host
         return impl().stop();
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::loadThreads(std::size_t amount)
+    {
+        return impl().loadThreads(amount);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::offloadThreads(std::size_t amount)
+    {
+        return impl().offloadThreads(amount);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::drainTimeout(std::chrono::milliseconds timeout)
+    {
+        return impl().drainTimeout(timeout);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::restartDowntime(std::chrono::microseconds downtime)
+    {
+        return impl().restartDowntime(downtime);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::watchdog(std::chrono::milliseconds stall, std::chrono::milliseconds abort)
+    {
+        return impl().watchdog(stall, abort);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::fiberStatsInterval(std::chrono::milliseconds interval)
+    {
+        return impl().fiberStatsInterval(interval);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const FiberStats& Manager::fiberStats()
+    {
+        return impl().fiberStats();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const LoopStats& Manager::loopStats()
+    {
+        return impl().loopStats();
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::placement(const std::string& loopCpus, const std::string& helperCpus, int numaNode)
+    {
+        return impl().placement(loopCpus, helperCpus, numaNode);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::post(std::function<void()>&& f)
+    {
+        return impl().post(std::move(f));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<> Manager::runOffloaded(std::function<void()>&& job)
+    {
+        return impl().runOffloaded(std::move(job));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Manager::preload()
+    {
+        return impl().preload();
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     bool Manager::startModules(std::set<std::string> &&modules, std::set<std::string> &&services)
     {
@@ -71,6 +149,18 @@ namespace dci::host
         return impl().runDaemons(argv);
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<> Manager::reloadModule(const std::string& name)
+    {
+        return impl().reloadModule(name);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    sbs::Signal<> Manager::binariesChanged()
+    {
+        return impl().binariesChanged();
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     cmt::Future<idl::Interface> Manager::createService(const idl::IId& iid)
     {
@@ -89,10 +179,22 @@ namespace dci::host
         return impl().createService(alias);
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    cmt::Future<std::vector<cmt::Future<idl::Interface>>> Manager::createServices(const std::vector<ServiceRequest>& requests)
+    {
+        return impl().createServices(requests);
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     cmt::Future<idl::Interface> Manager::getDaemonService(const std::string& name)
     {
         return impl().getDaemonService(name);
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Manager::startupReport(const std::string& jsonFile)
+    {
+        return impl().startupReport(jsonFile);
+    }
+
 }
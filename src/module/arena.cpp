@@ -0,0 +1,243 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/host/module/arena.hpp>
+#include <dci/logger.hpp>
+#include <algorithm>
+#include <new>
+
+#if __has_include(<sys/mman.h>)
+#   include <sys/mman.h>
+#   define DCI_HOST_ARENA_MMAP 1
+#endif
+
+namespace dci::host::module
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Arena::Arena(std::size_t reserve)
+        : _reserveSize{reserve}
+    {
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Arena::~Arena()
+    {
+        if(!release() && _region)
+        {
+            //живые объекты еще ссылаются на регион, безопаснее оставить его до конца процесса
+            LOGW("module arena destroyed with "<<_live<<" live objects, region leaked");
+        }
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Arena::reserveSize(std::size_t reserve)
+    {
+        if(_region)
+        {
+            return false;
+        }
+
+        //регион должен вмещать классы размеров целиком
+        _reserveSize = reserve / _granularity * _granularity;
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Arena::reserveSize() const
+    {
+        return _reserveSize;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void* Arena::allocate(std::size_t size)
+    {
+        ++_stats._allocations;
+
+        std::size_t index = classIndex(size);
+        if(index < _classesAmount && (_region || reserve()))
+        {
+            void* res {};
+
+            if(FreeNode* node = _free[index])
+            {
+                _free[index] = node->_next;
+                res = node;
+            }
+            else
+            {
+                std::size_t classSize = (index+1) * _granularity;
+                if(_reserveSize - _bump >= classSize)
+                {
+                    res = _region + _bump;
+                    _bump += classSize;
+                    _stats._touched = _bump;
+                }
+            }
+
+            if(res)
+            {
+                ++_live;
+                _stats._used += (index+1) * _granularity;
+                _stats._peak = std::max(_stats._peak, _stats._used);
+                return res;
+            }
+        }
+
+        ++_stats._fallbacks;
+        ++_live;
+        return ::operator new(size);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Arena::deallocate(void* p, std::size_t size)
+    {
+        if(!p)
+        {
+            return;
+        }
+
+        ++_stats._frees;
+        dbgAssert(_live);
+        --_live;
+
+        if(!inRegion(p))
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        std::size_t index = classIndex(size);
+        dbgAssert(index < _classesAmount);
+
+        FreeNode* node = static_cast<FreeNode*>(p);
+        node->_next = _free[index];
+        _free[index] = node;
+
+        _stats._used -= (index+1) * _granularity;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Arena::empty() const
+    {
+        return !_live;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Arena::release()
+    {
+        if(_live)
+        {
+            return false;
+        }
+
+        if(!_region)
+        {
+            return true;
+        }
+
+#ifdef DCI_HOST_ARENA_MMAP
+        ::munmap(_region, _reserveSize);
+#else
+        ::operator delete(_region);
+#endif
+
+        _region = nullptr;
+        _bump = 0;
+        _free.fill(nullptr);
+
+        _stats._reserved = 0;
+        _stats._touched = 0;
+        _stats._used = 0;
+        ++_stats._releases;
+
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Arena::pooledInc()
+    {
+        dbgAssert(_pooled < _live);
+        ++_pooled;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void Arena::pooledDec()
+    {
+        dbgAssert(_pooled);
+        --_pooled;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Arena::live() const
+    {
+        return _live;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Arena::pooled() const
+    {
+        return _pooled;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    const Arena::Stats& Arena::stats() const
+    {
+        return _stats;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Arena::classIndex(std::size_t size)
+    {
+        if(!size || size > _maxClassed)
+        {
+            return _classesAmount;
+        }
+
+        return (size + _granularity - 1) / _granularity - 1;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Arena::reserve()
+    {
+        if(!_reserveSize)
+        {
+            return false;
+        }
+
+#ifdef DCI_HOST_ARENA_MMAP
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#   ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#   endif
+        void* p = ::mmap(nullptr, _reserveSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if(MAP_FAILED == p)
+        {
+            LOGW("module arena: unable to reserve "<<_reserveSize<<" bytes, fallback to common heap");
+            _reserveSize = 0;
+            return false;
+        }
+        _region = static_cast<char*>(p);
+#else
+        _region = static_cast<char*>(::operator new(_reserveSize, std::nothrow));
+        if(!_region)
+        {
+            _reserveSize = 0;
+            return false;
+        }
+#endif
+
+        _stats._reserved = _reserveSize;
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool Arena::inRegion(void* p) const
+    {
+        const char* c = static_cast<const char*>(p);
+        return _region && c >= _region && c < _region + _reserveSize;
+    }
+}
@@ -75,6 +75,18 @@ namespace dci::host::module
         return StopLocker{this};
     }
 
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t Entry::stopLocks() const
+    {
+        return _stopLockCounter;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    Arena& Entry::arena()
+    {
+        return _arena;
+    }
+
     /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
     void Entry::stopLockCounterInc()
     {
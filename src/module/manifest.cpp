@@ -21,6 +21,8 @@ namespace dci::host::module
         _valid = false;
         _name.clear();
         _serviceIds.clear();
+        _requires.clear();
+        _arenaReserve = Arena::defaultReserve;
     }
 
     namespace
@@ -50,6 +52,18 @@ namespace dci::host::module
                     id._alias = v.second.data();
                 }
 
+                target._requires.clear();
+                for(auto& v: pt.get_child_optional("requires").get_value_or(npt))
+                {
+                    if(v.first.empty())
+                    {
+                       throw std::runtime_error("empty require");
+                    }
+                    target._requires.emplace_back(v.first);
+                }
+
+                target._arenaReserve = pt.get<std::size_t>("arenaReserve", Arena::defaultReserve);
+
                 target._valid = true;
             }
             catch(...)
@@ -98,6 +112,21 @@ namespace dci::host::module
                 }
                 pt.push_back(std::make_pair("serviceIds", vals));
             }
+
+            if(!_requires.empty())
+            {
+                ptree vals;
+                for(const auto& v : _requires)
+                {
+                    vals.push_back(std::make_pair(v, ptree()));
+                }
+                pt.push_back(std::make_pair("requires", vals));
+            }
+
+            if(Arena::defaultReserve != _arenaReserve)
+            {
+                pt.add("arenaReserve", _arenaReserve);
+            }
         }
 
         std::stringstream ss;
@@ -0,0 +1,99 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "parallel.hpp"
+#include "placement.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dci::host
+{
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t parallelism(std::size_t amount)
+    {
+        std::size_t hc = std::thread::hardware_concurrency();
+        if(!hc)
+        {
+            hc = 1;
+        }
+
+        return std::max(std::size_t{1}, std::min(hc, amount));
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    void parallelFor(std::size_t amount, const std::function<void(std::size_t)>& f, const std::vector<std::size_t>& cpus)
+    {
+        const std::size_t threadsAmount = parallelism(amount);
+
+        if(threadsAmount < 2)
+        {
+            for(std::size_t i{}; i<amount; ++i)
+            {
+                f(i);
+            }
+            return;
+        }
+
+        std::atomic<std::size_t> next{};
+        std::exception_ptr firstException;
+        std::mutex firstExceptionMtx;
+
+        auto worker = [&]
+        {
+            for(;;)
+            {
+                std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                if(i >= amount)
+                {
+                    return;
+                }
+
+                try
+                {
+                    f(i);
+                }
+                catch(...)
+                {
+                    std::lock_guard l{firstExceptionMtx};
+                    if(!firstException)
+                    {
+                        firstException = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadsAmount-1);
+        for(std::size_t i{1}; i<threadsAmount; ++i)
+        {
+            threads.emplace_back([&]
+            {
+                //без привязки задача выполнится там же, где и вызывающий, лучше так, чем отказ
+                std::string error;
+                pinHelperThread(cpus, error);
+                worker();
+            });
+        }
+
+        worker();
+
+        for(std::thread& t : threads)
+        {
+            t.join();
+        }
+
+        if(firstException)
+        {
+            std::rethrow_exception(firstException);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace dci::host
+{
+    //количество потоков, разумное для amount независимых задач
+    std::size_t parallelism(std::size_t amount);
+
+    //выполняет f(0..amount-1) в пуле потоков ОС, блокирует до завершения всех, первое исключение пробрасывается;
+    //дополнительные потоки привязываются к cpus, при пустом наборе привязка цикла с них снимается
+    void parallelFor(std::size_t amount, const std::function<void(std::size_t)>& f, const std::vector<std::size_t>& cpus = {});
+}
@@ -0,0 +1,242 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include "placement.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if __has_include(<sched.h>) && __has_include(<sys/syscall.h>) && __has_include(<unistd.h>)
+#   include <sched.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   define DCI_HOST_PLACEMENT_LINUX 1
+#endif
+
+namespace dci::host
+{
+    namespace
+    {
+#ifdef DCI_HOST_PLACEMENT_LINUX
+        //привязка процесса до первого pinCurrentThread, к ней возвращает unpinCurrentThread
+        std::once_flag  originalOnce;
+        cpu_set_t       original;
+        bool            originalValid = false;
+
+        void captureOriginal()
+        {
+            std::call_once(originalOnce, []
+            {
+                CPU_ZERO(&original);
+                originalValid = !sched_getaffinity(0, sizeof(original), &original);
+            });
+        }
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::size_t cpusLimit()
+    {
+#ifdef DCI_HOST_PLACEMENT_LINUX
+        long conf = sysconf(_SC_NPROCESSORS_CONF);
+        return conf > 0 ? std::min(static_cast<std::size_t>(conf), std::size_t{CPU_SETSIZE}) : std::size_t{CPU_SETSIZE};
+#else
+        return std::max(1u, std::thread::hardware_concurrency());
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool parseCpuList(std::string_view text, std::vector<std::size_t>& cpus)
+    {
+        cpus.clear();
+
+        const std::size_t limit = cpusLimit();
+
+        auto number = [](std::string_view v, std::size_t& res)
+        {
+            const char* end = v.data() + v.size();
+            std::from_chars_result r = std::from_chars(v.data(), end, res);
+            return std::errc{} == r.ec && end == r.ptr;
+        };
+
+        while(!text.empty())
+        {
+            std::size_t comma = text.find(',');
+            std::string_view item = text.substr(0, comma);
+            text = std::string_view::npos == comma ? std::string_view{} : text.substr(comma+1);
+
+            std::size_t first, last;
+            std::size_t dash = item.find('-');
+            if(std::string_view::npos == dash)
+            {
+                if(!number(item, first))
+                {
+                    return false;
+                }
+                last = first;
+            }
+            else if(!number(item.substr(0, dash), first) || !number(item.substr(dash+1), last) || last < first)
+            {
+                return false;
+            }
+
+            //до развертывания диапазона, иначе "0-4294967295" съест память
+            if(last >= limit)
+            {
+                return false;
+            }
+
+            for(std::size_t cpu{first}; cpu<=last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    std::string cpuListText(const std::vector<std::size_t>& cpus)
+    {
+        std::string res;
+        for(std::size_t i{}; i<cpus.size();)
+        {
+            std::size_t j{i};
+            while(j+1 < cpus.size() && cpus[j+1] == cpus[j]+1)
+            {
+                ++j;
+            }
+
+            if(!res.empty())
+            {
+                res += ',';
+            }
+            res += std::to_string(cpus[i]);
+            if(j > i)
+            {
+                res += '-';
+                res += std::to_string(cpus[j]);
+            }
+
+            i = j+1;
+        }
+
+        return res;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool pinCurrentThread(const std::vector<std::size_t>& cpus, std::string& error)
+    {
+        if(cpus.empty())
+        {
+            return true;
+        }
+
+#ifdef DCI_HOST_PLACEMENT_LINUX
+        captureOriginal();
+
+        const std::size_t amount = cpus.back()+1;
+        cpu_set_t* set = CPU_ALLOC(amount);
+        if(!set)
+        {
+            error = "unable to allocate cpu set";
+            return false;
+        }
+
+        const std::size_t size = CPU_ALLOC_SIZE(amount);
+        CPU_ZERO_S(size, set);
+        for(std::size_t cpu : cpus)
+        {
+            CPU_SET_S(cpu, size, set);
+        }
+
+        int res = sched_setaffinity(0, size, set);
+        CPU_FREE(set);
+
+        if(res)
+        {
+            error = std::string{"sched_setaffinity: "} + strerror(errno);
+            return false;
+        }
+
+        return true;
+#else
+        error = "cpu affinity is not supported on this platform";
+        return false;
+#endif
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool unpinCurrentThread(std::string& error)
+    {
+#ifdef DCI_HOST_PLACEMENT_LINUX
+        captureOriginal();
+
+        if(!originalValid)
+        {
+            error = "original cpu affinity is unknown";
+            return false;
+        }
+
+        if(sched_setaffinity(0, sizeof(original), &original))
+        {
+            error = std::string{"sched_setaffinity: "} + strerror(errno);
+            return false;
+        }
+#else
+        (void)error;
+#endif
+        return true;
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool pinHelperThread(const std::vector<std::size_t>& cpus, std::string& error)
+    {
+        if(cpus.empty())
+        {
+            return unpinCurrentThread(error);
+        }
+
+        return pinCurrentThread(cpus, error);
+    }
+
+    /////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+    bool bindMemoryToNode(int node, std::string& error)
+    {
+        if(0 > node)
+        {
+            return true;
+        }
+
+#if defined(DCI_HOST_PLACEMENT_LINUX) && defined(SYS_set_mempolicy)
+        //MPOL_BIND из numaif.h, без зависимости от libnuma
+        constexpr int mpolBind = 2;
+        constexpr std::size_t bits = sizeof(unsigned long) * CHAR_BIT;
+
+        std::vector<unsigned long> mask(static_cast<std::size_t>(node)/bits + 1);
+        mask[static_cast<std::size_t>(node)/bits] = 1ul << (static_cast<std::size_t>(node)%bits);
+
+        //ядро читает maxnode-1 бит
+        if(syscall(SYS_set_mempolicy, mpolBind, mask.data(), mask.size()*bits + 1))
+        {
+            error = std::string{"set_mempolicy: "} + strerror(errno);
+            return false;
+        }
+
+        return true;
+#else
+        error = "numa binding is not supported on this platform";
+        return false;
+#endif
+    }
+}
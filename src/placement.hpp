@@ -0,0 +1,34 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dci::host
+{
+    //номера процессоров из текста вида "0-3,8,10-11", пустой текст - пустой набор; номера не меньше cpusLimit отвергаются
+    std::size_t cpusLimit();
+    bool parseCpuList(std::string_view text, std::vector<std::size_t>& cpus);
+    std::string cpuListText(const std::vector<std::size_t>& cpus);
+
+    //для вызывающего потока, потоки созданные им позже наследуют
+    bool pinCurrentThread(const std::vector<std::size_t>& cpus, std::string& error);
+
+    //вернуть вызывающему потоку привязку процесса до первого pinCurrentThread;
+    //служебные потоки (сторож, профилировщик, метрики) не должны отнимать процессор у цикла
+    bool unpinCurrentThread(std::string& error);
+
+    //для вспомогательных потоков (offload, parallelFor): на cpus, а при пустом наборе - снять унаследованную привязку цикла
+    bool pinHelperThread(const std::vector<std::size_t>& cpus, std::string& error);
+
+    //MPOL_BIND на узел для последующих размещений вызывающего потока, тоже наследуется
+    bool bindMemoryToNode(int node, std::string& error);
+}
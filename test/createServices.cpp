@@ -0,0 +1,41 @@
+/* This file is part of the the dci project. Copyright (C) 2013-2023 vopl, shtoba.
+   This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more details.
+   You should have received a copy of the GNU Affero General Public License along with this program. If not, see <https://www.gnu.org/licenses/>. */
+
+#include <dci/test.hpp>
+#include <dci/host/manager.hpp>
+#include <dci/host/test.hpp>
+#include "idl-host.hpp"
+
+using namespace dci;
+
+/////////0/////////1/////////2/////////3/////////4/////////5/////////6/////////7
+//собственные сервисы хоста создаются и пакетом, как одиночным вызовом, без модулей
+TEST(host, createServices_hostOwned)
+{
+    host::Manager* manager = host::testManager();
+    ASSERT_TRUE(manager);
+
+    using Introspection = idl::gen::host::Introspection<>;
+
+    cmt::Future<idl::Interface> single = manager->createService(Introspection::lid());
+    ASSERT_TRUE(single.resolvedValue());
+
+    cmt::Future<std::vector<cmt::Future<idl::Interface>>> batch = manager->createServices(
+    {
+        host::Manager::ServiceRequest{Introspection::lid()},
+        host::Manager::ServiceRequest{std::string{"host::test::absent"}},
+    });
+
+    std::vector<cmt::Future<idl::Interface>> results = batch.value();
+    ASSERT_EQ(2u, results.size());
+    EXPECT_TRUE(results[0].resolvedValue());
+    EXPECT_TRUE(results[1].resolvedException());
+
+    cmt::Future<std::tuple<Introspection>> typed = manager->createServices<Introspection>();
+    typed.wait();
+    EXPECT_TRUE(typed.resolvedValue());
+}